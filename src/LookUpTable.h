@@ -44,7 +44,7 @@
  *   0          1        0          1
  */
 //-----------------------------------------------------------------------------
-static const char cases[256][2] = {
+static constexpr char cases[256][2] = {
 /*   0:                          */  {  0, -1 },
 /*   1: 0,                       */  {  1,  0 },
 /*   2:    1,                    */  {  1,  1 },
@@ -316,7 +316,7 @@ static const char cases[256][2] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling1[16][3] = {
+static constexpr char tiling1[16][3] = {
 /*   1: 0,                       */  {  0,  8,  3 },
 /*   2:    1,                    */  {  0,  1,  9 },
 /*   4:       2,                 */  {  1,  2, 10 },
@@ -348,7 +348,7 @@ static const char tiling1[16][3] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling2[24][6] = {
+static constexpr char tiling2[24][6] = {
 /*   3: 0, 1,                    */  {  1,  8,  3,  9,  8,  1 },
 /*   9: 0,       3,              */  {  0, 11,  2,  8, 11,  0 },
 /*  17: 0,          4,           */  {  4,  3,  0,  7,  3,  4 },
@@ -391,7 +391,7 @@ static const char tiling2[24][6] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char test3[24] = {
+static constexpr char test3[24] = {
 /*   5: 0,    2,                 */    5,
 /*  33: 0,             5,        */    1,
 // my_comment: 129 只需要测试面 4 就行了，根据面 4 的正负情况去判断使用哪个歧义小类
@@ -431,7 +431,7 @@ static const char test3[24] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling3_1[24][6] = {
+static constexpr char tiling3_1[24][6] = {
 /*   5: 0,    2,                 */  {  0,  8,  3,  1,  2, 10 },
 /*  33: 0,             5,        */  {  9,  5,  4,  0,  8,  3 },
 /* 129: 0,                   7,  */  {  3,  0,  8, 11,  7,  6 },
@@ -469,7 +469,7 @@ static const char tiling3_1[24][6] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling3_2[24][12] = {
+static constexpr char tiling3_2[24][12] = {
 /*   5: 0,    2,                 */  { 10,  3,  2, 10,  8,  3, 10,  1,  0,  8, 10,  0 },
 /*  33: 0,             5,        */  {  3,  4,  8,  3,  5,  4,  3,  0,  9,  5,  3,  9 },
 /* 129: 0,                   7,  */  {  6,  8,  7,  6,  0,  8,  6, 11,  3,  0,  6,  3 },
@@ -514,7 +514,7 @@ static const char tiling3_2[24][12] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char test4[8] = {
+static constexpr char test4[8] = {
 /*  65: 0,                6,     */   7,
 /* 130:    1,                7,  */   7,
 /*  20:       2,    4,           */   7,
@@ -536,7 +536,7 @@ static const char test4[8] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling4_1[8][6] = {
+static constexpr char tiling4_1[8][6] = {
 /*  65: 0,                6,     */  {  0,  8,  3,  5, 10,  6 },
 /* 130:    1,                7,  */  {  0,  1,  9, 11,  7,  6 },
 /*  20:       2,    4,           */  {  1,  2, 10,  8,  4,  7 },
@@ -558,7 +558,7 @@ static const char tiling4_1[8][6] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling4_2[8][18] = {
+static constexpr char tiling4_2[8][18] = {
 /*  65: 0,                6,     */  {  8,  5,  0,  5,  8,  6,  3,  6,  8,  6,  3, 10,  0, 10,  3, 10,  0,  5 },
 /* 130:    1,                7,  */  {  9,  6,  1,  6,  9,  7,  0,  7,  9,  7,  0, 11,  1, 11,  0, 11,  1,  6 },
 /*  20:       2,    4,           */  { 10,  7,  2,  7, 10,  4,  1,  4, 10,  4,  1,  8,  2,  8,  1,  8,  2,  7 },
@@ -582,7 +582,7 @@ static const char tiling4_2[8][18] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling5[48][9] = {
+static constexpr char tiling5[48][9] = {
 /*   7: 0, 1, 2,                 */  {  2,  8,  3,  2, 10,  8, 10,  9,  8 },
 /*  11: 0, 1,    3,              */  {  1, 11,  2,  1,  9, 11,  9,  8, 11 },
 /*  19: 0, 1,       4,           */  {  4,  1,  9,  4,  7,  1,  7,  3,  1 },
@@ -653,7 +653,7 @@ static const char tiling5[48][9] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char test6[48][3] = {
+static constexpr char test6[48][3] = {
 // my_comment: 第 1 个数还是 face 测试的面没有变，第 2 个数只用了 7 和 -7，-7 表示要将结果取负，第 3 个数表示边的编号，用来表示需要测试的内部
 // my_comment: 注意点的标号是 0-11，但是面的标号是 1-6，明显看出后两个不是点
 // the direction of P is encoded as an edge
@@ -723,7 +723,7 @@ static const char test6[48][3] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling6_1_1[48][9] = {
+static constexpr char tiling6_1_1[48][9] = {
 /*  67: 0, 1,             6,     */  {  6,  5, 10,  3,  1,  8,  9,  8,  1 },
 /* 131: 0, 1,                7,  */  { 11,  7,  6,  9,  3,  1,  3,  9,  8 },
 /*  21: 0,    2,    4,           */  {  1,  2, 10,  7,  0,  4,  0,  7,  3 },
@@ -785,7 +785,7 @@ static const char tiling6_1_1[48][9] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling6_1_2[48][27] = {
+static constexpr char tiling6_1_2[48][27] = {
   /*  67: 0, 1,             6,     */ {  1, 12,  3,   12, 10,  3,    6,  3, 10,    3,  6,  8,    5,  8,  6,    8,  5, 12,   12,  9,  8,    1,  9, 12,   12,  5, 10  },
   /* 131: 0, 1,                7,  */ {  1, 12,  3,    1, 11, 12,   11,  1,  6,    9,  6,  1,    6,  9,  7,   12,  7,  9,    9,  8, 12,   12,  8,  3,   11,  7, 12  },
   /*  21: 0,    2,    4,           */ {  4, 12,  0,    4,  1, 12,    1,  4, 10,    7, 10,  4,   10,  7,  2,   12,  2,  7,    7,  3, 12,   12,  3,  0,    1,  2, 12  },
@@ -847,7 +847,7 @@ static const char tiling6_1_2[48][27] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling6_2[48][15] = {
+static constexpr char tiling6_2[48][15] = {
 /*  67: 0, 1,             6,     */  {  1, 10,  3,  6,  3, 10,  3,  6,  8,  5,  8,  6,  8,  5,  9 },
 /* 131: 0, 1,                7,  */  {  1, 11,  3, 11,  1,  6,  9,  6,  1,  6,  9,  7,  8,  7,  9 },
 /*  21: 0,    2,    4,           */  {  4,  1,  0,  1,  4, 10,  7, 10,  4, 10,  7,  2,  3,  2,  7 },
@@ -925,7 +925,7 @@ static const char tiling6_2[48][15] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char test7[16][5] = {
+static constexpr char test7[16][5] = {
 /*  37: 0,    2,       5,        */  {  1,  2,  5,  7,   1 },
 /* 133: 0,    2,             7,  */  {  3,  4,  5,  7,   3 },
 /* 161: 0,             5,    7,  */  {  4,  1,  6,  7,   4 },
@@ -955,7 +955,7 @@ static const char test7[16][5] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling7_1[16][9] = {
+static constexpr char tiling7_1[16][9] = {
 /*  37: 0,    2,       5,        */  {  9,  5,  4, 10,  1,  2,  8,  3,  0 },
 /* 133: 0,    2,             7,  */  { 11,  7,  6,  8,  3,  0, 10,  1,  2 },
 /* 161: 0,             5,    7,  */  {  3,  0,  8,  5,  4,  9,  7,  6, 11 },
@@ -985,7 +985,7 @@ static const char tiling7_1[16][9] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling7_2[16][3][15] = {
+static constexpr char tiling7_2[16][3][15] = {
 /*  37: 0,    2,       5,        */  {
  /* 1,0 */ {  1,  2, 10,  3,  4,  8,  4,  3,  5,  0,  5,  3,  5,  0,  9 },
  /* 0,1 */ {  3,  0,  8,  9,  1,  4,  2,  4,  1,  4,  2,  5, 10,  5,  2 },
@@ -1078,7 +1078,7 @@ static const char tiling7_2[16][3][15] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling7_3[16][3][27] = {
+static constexpr char tiling7_3[16][3][27] = {
 /*  37: 0,    2,       5,        */  {
  /* 1,0 */ { 12,  2, 10, 12, 10,  5, 12,  5,  4, 12,  4,  8, 12,  8,  3, 12,  3,  0, 12,  0,  9, 12,  9,  1, 12,  1,  2 },
  /* 0,1 */ { 12,  5,  4, 12,  4,  8, 12,  8,  3, 12,  3,  2, 12,  2, 10, 12, 10,  1, 12,  1,  0, 12,  0,  9, 12,  9,  5 },
@@ -1171,7 +1171,7 @@ static const char tiling7_3[16][3][27] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling7_4_1[16][15] = {
+static constexpr char tiling7_4_1[16][15] = {
 /*  37: 0,    2,       5,        */  {  3,  4,  8,  4,  3, 10,  2, 10,  3,  4, 10,  5,  9,  1,  0 },
 /* 133: 0,    2,             7,  */  {  1,  6, 10,  6,  1,  8,  0,  8,  1,  6,  8,  7, 11,  3,  2 },
 /* 161: 0,             5,    7,  */  { 11,  3,  6,  9,  6,  3,  6,  9,  5,  0,  9,  3,  7,  4,  8 },
@@ -1201,7 +1201,7 @@ static const char tiling7_4_1[16][15] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling7_4_2[16][27] = {
+static constexpr char tiling7_4_2[16][27] = {
 /*  37: 0,    2,       5,        */  {   9,  4,  8,  4,  9,  5, 10,  5,  9,  1, 10,  9, 10,  1,  2,  0,  2,  1,  2,  0,  3,  8,  3,  0,  9,  8,  0 },
 /* 133: 0,    2,             7,  */  {  11,  6, 10,  6, 11,  7,  8,  7, 11,  3,  8, 11,  8,  3,  0,  2,  0,  3,  0,  2,  1, 10,  1,  2, 11, 10,  2 },
 /* 161: 0,             5,    7,  */  {  11,  3,  8,  0,  8,  3,  8,  0,  9,  8,  9,  4,  5,  4,  9,  4,  5,  7,  6,  7,  5,  7,  6, 11,  7, 11,  8 },
@@ -1233,7 +1233,7 @@ static const char tiling7_4_2[16][27] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling8[6][6] = {
+static constexpr char tiling8[6][6] = {
 /*  15: 0, 1, 2, 3,              */  { 9,  8, 10, 10,  8, 11 },
 /*  51: 0, 1,       4, 5,        */  { 1,  5,  3,  3,  5,  7 },
 /* 153: 0,       3, 4,       7,  */  { 0,  4,  2,  4,  6,  2 },
@@ -1255,7 +1255,7 @@ static const char tiling8[6][6] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling9[8][12] = {
+static constexpr char tiling9[8][12] = {
 /*  39: 0, 1, 2,       5,        */  {  2, 10,  5,  3,  2,  5,  3,  5,  4,  3,  4,  8 },
 /*  27: 0, 1,    3, 4,           */  {  4,  7, 11,  9,  4, 11,  9, 11,  2,  9,  2,  1 },
 /* 141: 0,    2, 3,          7,  */  { 10,  7,  6,  1,  7, 10,  1,  8,  7,  1,  0,  8 },
@@ -1288,7 +1288,7 @@ static const char tiling9[8][12] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char test10[6][3] = {
+static constexpr char test10[6][3] = {
 /* 195: 0, 1,             6, 7,  */  {  2,  4,  7 },
 /*  85: 0,    2,    4,    6,     */  {  5,  6,  7 },
 /* 105: 0,       3,    5, 6,     */  {  1,  3,  7 },
@@ -1308,7 +1308,7 @@ static const char test10[6][3] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling10_1_1[6][12] = {
+static constexpr char tiling10_1_1[6][12] = {
 /* 195: 0, 1,             6, 7,  */  {  5, 10,  7, 11,  7, 10,  8,  1,  9,  1,  8,  3 },
 /*  85: 0,    2,    4,    6,     */  {  1,  2,  5,  6,  5,  2,  4,  3,  0,  3,  4,  7 },
 /* 105: 0,       3,    5, 6,     */  { 11,  0,  8,  0, 11,  2,  4,  9,  6, 10,  6,  9 },
@@ -1328,7 +1328,7 @@ static const char tiling10_1_1[6][12] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling10_1_1_[6][12] = {
+static constexpr char tiling10_1_1_[6][12] = {
 /* 195: 0, 1,             6, 7,  */  {  5,  9,  7,  8,  7,  9, 11,  1, 10,  1, 11,  3 },
 /*  85: 0,    2,    4,    6,     */  {  3,  2,  7,  6,  7,  2,  4,  1,  0,  1,  4,  5 },
 /* 105: 0,       3,    5, 6,     */  { 10,  0,  9,  0, 10,  2,  4,  8,  6, 11,  6,  8 },
@@ -1348,7 +1348,7 @@ static const char tiling10_1_1_[6][12] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling10_1_2[6][24] = {
+static constexpr char tiling10_1_2[6][24] = {
 /* 195: 0, 1,             6, 7,  */  {  3, 11,  7,  3,  7,  8,  9,  8,  7,  5,  9,  7,  9,  5, 10,  9, 10,  1,  3,  1, 10, 11,  3, 10 },
 /*  85: 0,    2,    4,    6,     */  {  7,  6,  5,  7,  5,  4,  0,  4,  5,  1,  0,  5,  0,  1,  2,  0,  2,  3,  7,  3,  2,  6,  7,  2 },
 /* 105: 0,       3,    5, 6,     */  { 11,  2, 10,  6, 11, 10, 11,  6,  4, 11,  4,  8,  0,  8,  4,  9,  0,  4,  0,  9, 10,  0, 10,  2 },
@@ -1368,7 +1368,7 @@ static const char tiling10_1_2[6][24] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling10_2[6][24] = {
+static constexpr char tiling10_2[6][24] = {
 /* 195: 0, 1,             6, 7,  */  { 12,  5,  9, 12,  9,  8, 12,  8,  3, 12,  3,  1, 12,  1, 10, 12, 10, 11, 12, 11,  7, 12,  7,  5 },
 /*  85: 0,    2,    4,    6,     */  { 12,  1,  0, 12,  0,  4, 12,  4,  7, 12,  7,  3, 12,  3,  2, 12,  2,  6, 12,  6,  5, 12,  5,  1 },
 /* 105: 0,       3,    5, 6,     */  {  4,  8, 12,  6,  4, 12, 10,  6, 12,  9, 10, 12,  0,  9, 12,  2,  0, 12, 11,  2, 12,  8, 11, 12 },
@@ -1388,7 +1388,7 @@ static const char tiling10_2[6][24] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling10_2_[6][24] = {
+static constexpr char tiling10_2_[6][24] = {
 /* 195: 0, 1,             6, 7,  */  {  8,  7, 12,  9,  8, 12,  1,  9, 12,  3,  1, 12, 11,  3, 12, 10, 11, 12,  5, 10, 12,  7,  5, 12 },
 /*  85: 0,    2,    4,    6,     */  {  4,  5, 12,  0,  4, 12,  3,  0, 12,  7,  3, 12,  6,  7, 12,  2,  6, 12,  1,  2, 12,  5,  1, 12 },
 /* 105: 0,       3,    5, 6,     */  { 12, 11,  6, 12,  6,  4, 12,  4,  9, 12,  9, 10, 12, 10,  2, 12,  2,  0, 12,  0,  8, 12,  8, 11 },
@@ -1410,7 +1410,7 @@ static const char tiling10_2_[6][24] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling11[12][12] = {
+static constexpr char tiling11[12][12] = {
 /*  23: 0, 1, 2,    4,           */  { 2, 10,  9,  2,  9,  7,  2,  7,  3,  7,  9,  4 },
 /* 139: 0, 1,    3,          7,  */  { 1,  6,  2,  1,  8,  6,  1,  9,  8,  8,  7,  6 },
 /*  99: 0, 1,          5, 6,     */  { 8,  3,  1,  8,  1,  6,  8,  6,  4,  6,  1, 10 },
@@ -1447,7 +1447,7 @@ static const char tiling11[12][12] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char test12[24][4] = {
+static constexpr char test12[24][4] = {
 /* 135: 0, 1, 2,             7,  */  {  4,  3,  7,  11 },
 /*  75: 0, 1,    3,       6,     */  {  3,  2,  7,  10 },
 /*  83: 0, 1,       4,    6,     */  {  2,  6,  7,   5 },
@@ -1485,7 +1485,7 @@ static const char test12[24][4] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling12_1_1[24][12] = {
+static constexpr char tiling12_1_1[24][12] = {
 /* 135: 0, 1, 2,             7,  */  {  7,  6, 11, 10,  3,  2,  3, 10,  8,  9,  8, 10 },
 /*  75: 0, 1,    3,       6,     */  {  6,  5, 10,  9,  2,  1,  2,  9, 11,  8, 11,  9 },
 /*  83: 0, 1,       4,    6,     */  { 10,  6,  5,  7,  9,  4,  9,  7,  1,  3,  1,  7 },
@@ -1523,7 +1523,7 @@ static const char tiling12_1_1[24][12] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling12_1_1_[24][12] = {
+static constexpr char tiling12_1_1_[24][12] = {
 /* 135: 0, 1, 2,             7,  */  {  3,  2, 11, 10,  7,  6,  7, 10,  8,  9,  8, 10 },
 /*  75: 0, 1,    3,       6,     */  {  2,  1, 10,  9,  6,  5,  6,  9, 11,  8, 11,  9 },
 /*  83: 0, 1,       4,    6,     */  {  9,  4,  5,  7, 10,  6, 10,  7,  1,  3,  1,  7 },
@@ -1561,7 +1561,7 @@ static const char tiling12_1_1_[24][12] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling12_1_2[24][24] = {
+static constexpr char tiling12_1_2[24][24] = {
 /* 135: 0, 1, 2,             7,  */  {  7,  3, 11,  3,  7,  8,  9,  8,  7,  6,  9,  7,  9,  6, 10,  2, 10,  6, 11,  2,  6,  2, 11,  3 },
 /*  75: 0, 1,    3,       6,     */  {  6,  2, 10,  2,  6, 11,  8, 11,  6,  5,  8,  6,  8,  5,  9,  1,  9,  5, 10,  1,  5,  1, 10,  2 },
 /*  83: 0, 1,       4,    6,     */  { 10,  9,  5,  9, 10,  1,  3,  1, 10,  6,  3, 10,  3,  6,  7,  4,  7,  6,  5,  4,  6,  4,  5,  9 },
@@ -1599,7 +1599,7 @@ static const char tiling12_1_2[24][24] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling12_2[24][24] = {
+static constexpr char tiling12_2[24][24] = {
 /* 135: 0, 1, 2,             7,  */  {   9,  8, 12, 10,  9, 12,  2, 10, 12,  3,  2, 12, 11,  3, 12,  6, 11, 12,  7,  6, 12,  8,  7, 12 },
 /*  75: 0, 1,    3,       6,     */  {   8, 11, 12,  9,  8, 12,  1,  9, 12,  2,  1, 12, 10,  2, 12,  5, 10, 12,  6,  5, 12, 11,  6, 12 },
 /*  83: 0, 1,       4,    6,     */  {   3,  1, 12,  7,  3, 12,  4,  7, 12,  9,  4, 12,  5,  9, 12,  6,  5, 12, 10,  6, 12,  1, 10, 12 },
@@ -1637,7 +1637,7 @@ static const char tiling12_2[24][24] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling12_2_[24][24] = {
+static constexpr char tiling12_2_[24][24] = {
 /* 135: 0, 1, 2,             7,  */  { 12,  2, 11, 12, 11,  7, 12,  7,  6, 12,  6, 10, 12, 10,  9, 12,  9,  8, 12,  8,  3, 12,  3,  2 },
 /*  75: 0, 1,    3,       6,     */  { 12,  1, 10, 12, 10,  6, 12,  6,  5, 12,  5,  9, 12,  9,  8, 12,  8, 11, 12, 11,  2, 12,  2,  1 },
 /*  83: 0, 1,       4,    6,     */  { 12,  4,  5, 12,  5, 10, 12, 10,  6, 12,  6,  7, 12,  7,  3, 12,  3,  1, 12,  1,  9, 12,  9,  4 },
@@ -1681,7 +1681,7 @@ static const char tiling12_2_[24][24] = {
  */
 //-----------------------------------------------------------------------------
 /* 13: face test */
-static const char test13[2][7] = {
+static constexpr char test13[2][7] = {
 /* 165: 0,    2,       5,    7,  */  { 1,2,3,4,5,6,7 },
 /*  90:    1,    3, 4,    6,     */  { 2,3,4,1,5,6,7 },
 };
@@ -1703,7 +1703,7 @@ static const char test13[2][7] = {
  */
 //-----------------------------------------------------------------------------
 /* 13: sub configs */
-static const char subconfig13[64] = {
+static constexpr char subconfig13[64] = {
 /*  0: 0,0,0,0,0,0 */   0,
 /*  1: 1,0,0,0,0,0 */   1,
 /*  2: 0,1,0,0,0,0 */   2,
@@ -1783,7 +1783,7 @@ static const char subconfig13[64] = {
  */
 //-----------------------------------------------------------------------------
 /* 13.1 */
-static const char tiling13_1[2][12] = {
+static constexpr char tiling13_1[2][12] = {
 /* 165: 0,    2,       5,    7,  */  { 11,  7,  6,  1,  2, 10,  8,  3,  0,  9,  5, 4 },
 /*  90:    1,    3, 4,    6,     */  {  8,  4,  7,  2,  3, 11,  9,  0,  1, 10,  6, 5 }
 };
@@ -1800,7 +1800,7 @@ static const char tiling13_1[2][12] = {
  */
 //-----------------------------------------------------------------------------
 /* 13.1 */
-static const char tiling13_1_[2][12] = {
+static constexpr char tiling13_1_[2][12] = {
 /* 165: 0,    2,       5,    7,  */  { 7,  4,  8, 11,  3,  2,  1,  0,  9,  5,  6, 10 },
 /*  90:    1,    3, 4,    6,     */  { 6,  7, 11, 10,  2,  1,  0,  3,  8,  4,  5,  9 }
 };
@@ -1817,7 +1817,7 @@ static const char tiling13_1_[2][12] = {
  */
 //-----------------------------------------------------------------------------
 /* 13.2 */
-static const char tiling13_2[2][6][18] = {
+static constexpr char tiling13_2[2][6][18] = {
 /* 165: 0,    2,       5,    7,  */  {
  /* 1 */ { 1,  2, 10, 11,  7,  6,  3,  4,  8,  4,  3,  5,  0,  5,  3,  5,  0,  9 },
  /* 2 */ { 8,  3,  0, 11,  7,  6,  9,  1,  4,  2,  4,  1,  4,  2,  5, 10,  5,  2 },
@@ -1847,7 +1847,7 @@ static const char tiling13_2[2][6][18] = {
  */
 //-----------------------------------------------------------------------------
 /* 13.2 */
-static const char tiling13_2_[2][6][18] = {
+static constexpr char tiling13_2_[2][6][18] = {
 /* 165: 0,    2,       5,    7,  */  {
  /* 1 */ { 10,  5,  6, 11,  3,  2,  7,  0,  8,  0,  7,  1,  4,  1,  7,  1,  4,  9 },
  /* 2 */ { 11,  3,  2,  7,  4,  8,  9,  5,  0,  6,  0,  5,  0,  6,  1, 10,  1,  6 },
@@ -1877,7 +1877,7 @@ static const char tiling13_2_[2][6][18] = {
  */
 //-----------------------------------------------------------------------------
 /* 13.3 */
-static const char tiling13_3[2][12][30] = {
+static constexpr char tiling13_3[2][12][30] = {
 /* 165: 0,    2,       5,    7,  */  {
  /* 1,2 */ { 11,  7,  6, 12,  2, 10, 12, 10,  5, 12,  5,  4, 12,  4,  8, 12,  8,  3, 12,  3,  0, 12,  0,  9, 12,  9,  1, 12,  1,  2 },
  /* 1,4 */ {  1,  2, 10,  9,  5, 12,  0,  9, 12,  3,  0, 12, 11,  3, 12,  6, 11, 12,  7,  6, 12,  8,  7, 12,  4,  8, 12,  5,  4, 12 },
@@ -1919,7 +1919,7 @@ static const char tiling13_3[2][12][30] = {
  */
 //-----------------------------------------------------------------------------
 /* 13.3 */
-static const char tiling13_3_[2][12][30] = {
+static constexpr char tiling13_3_[2][12][30] = {
 /* 165: 0,    2,       5,    7,  */  {
  /* 1,2 */ {  3,  2, 11,  8,  7, 12,  0,  8, 12,  1,  0, 12, 10,  1, 12,  6, 10, 12,  5,  6, 12,  9,  5, 12,  4,  9, 12,  7,  4, 12 },
  /* 1,4 */ {  5,  6, 10, 12,  2, 11, 12, 11,  7, 12,  7,  4, 12,  4,  9, 12,  9,  1, 12,  1,  0, 12,  0,  8, 12,  8,  3, 12,  3,  2 },
@@ -1961,7 +1961,7 @@ static const char tiling13_3_[2][12][30] = {
  */
 //-----------------------------------------------------------------------------
 /* 13.4 */
-static const char tiling13_4[2][4][36] = {
+static constexpr char tiling13_4[2][4][36] = {
 /* 165: 0,    2,       5,    7,  */  {
 /* 1,2,6 */  { 12,  2, 10, 12, 10,  5, 12,  5,  6, 12,  6, 11, 12, 11,  7, 12,  7,  4, 12,  4,  8, 12,  8,  3, 12,  3,  0, 12,  0,  9, 12,  9,  1, 12,  1,  2 },
 /* 1,4,5 */  { 11,  3, 12,  6, 11, 12,  7,  6, 12,  8,  7, 12,  4,  8, 12,  5,  4, 12,  9,  5, 12,  0,  9, 12,  1,  0, 12, 10,  1, 12,  2, 10, 12,  3,  2, 12 },
@@ -1988,7 +1988,7 @@ static const char tiling13_4[2][4][36] = {
  */
 //-----------------------------------------------------------------------------
 /* 13.5.1 */
-static const char tiling13_5_1[2][4][18] = {
+static constexpr char tiling13_5_1[2][4][18] = {
 /* 165: 0,    2,       5,    7,  */  {
 /* 1,2,5 */  {  7,  6, 11,  1,  0,  9, 10,  3,  2,  3, 10,  5,  3,  5,  8,  4,  8, 5 },
 /* 1,4,6 */  {  1,  2, 10,  7,  4,  8,  3,  0, 11,  6, 11,  0,  9,  6,  0,  6,  9, 5 },
@@ -2014,7 +2014,7 @@ static const char tiling13_5_1[2][4][18] = {
  */
 //-----------------------------------------------------------------------------
 /* 13.5.2 */
-static const char tiling13_5_2[2][4][30] = {
+static constexpr char tiling13_5_2[2][4][30] = {
 /* 165: 0,    2,       5,    7,  */  {
 /* 1,2,5 */  { 1,  0,  9,  7,  4,  8,  7,  8,  3,  7,  3, 11,  2, 11,  3, 11,  2, 10, 11, 10,  6,  5,  6, 10,  6,  5,  7,  4,  7, 5 },
 /* 1,4,6 */  { 7,  4,  8, 11,  3,  2,  6, 11,  2, 10,  6,  2,  6, 10,  5,  9,  5, 10,  1,  9, 10,  9,  1,  0,  2,  0,  1,  0,  2, 3 },
@@ -2042,7 +2042,7 @@ static const char tiling13_5_2[2][4][30] = {
  * A minus sign means to invert the result of the test.
  */
 //-----------------------------------------------------------------------------
-static const char tiling14[12][12] = {
+static constexpr char tiling14[12][12] = {
 /*  71: 0, 1, 2,          6,     */  {  5,  9,  8,  5,  8,  2,  5,  2,  6,  3,  2,  8 },
 /*  43: 0, 1,    3,    5,        */  {  2,  1,  5,  2,  5,  8,  2,  8, 11,  4,  8,  5 },
 /* 147: 0, 1,       4,       7,  */  {  9,  4,  6,  9,  6,  3,  9,  3,  1, 11,  3,  6 },
@@ -2071,7 +2071,7 @@ static const char tiling14[12][12] = {
  * the cube is not.
  */
 //-----------------------------------------------------------------------------
-static const char casesClassic[256][16] = {
+static constexpr char casesClassic[256][16] = {
 /*   0:                          */  { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
 /*   1: 0,                       */  {  0,  8,  3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
 /*   2:    1,                    */  {  0,  1,  9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
@@ -0,0 +1,465 @@
+﻿#include "adaptive_octree.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// 节点的 8 个角：第 c 个角相对节点起点的偏移为 (c & 1, (c >> 1) & 1, (c >> 2) & 1) * size
+// 12 条边的两个端点，第 e 条边的方向为 e / 4
+const int LEAF_EDGES[12][2] = {
+    {0, 1}, {2, 3}, {4, 5}, {6, 7},
+    {0, 2}, {1, 3}, {4, 6}, {5, 7},
+    {0, 4}, {1, 5}, {2, 6}, {3, 7}};
+// 围着 axis 方向的边的 4 个格子在 (axis + 1) % 3、(axis + 2) % 3 两个方向上的偏移，和 FlyingEdges 的 Surface Nets 一样
+const int QUAD_CELLS[4][2] = {{-1, -1}, {0, -1}, {0, 0}, {-1, 0}};
+// 遍历八叉树时栈的大小：每一层最多留下 7 个兄弟节点
+const int STACK_SIZE = 64;
+
+}  // namespace
+
+bool AdaptiveOctree::extract(const BrickExtractor::Settings& settings, float tolerance, const CancellationToken* token, const WorkProgressCallback& progress, std::vector<Vertex>& vertices, std::vector<std::array<int, 3>>& triangles, float bmin[3], float bmax[3]) {
+    this->settings = &settings;
+    this->progress = &progress;
+    this->tolerance = tolerance;
+    lo = settings.box.lo, hi = settings.box.hi;
+    // 某个方向上 box 只有一层体素的话里面没有 cube
+    for (int a = 0; a < 3; a++) {
+        if (lo[a] >= hi[a]) return true;
+        blockCount[a] = (hi[a] - lo[a] + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    }
+    int blocks = blockCount[0] * blockCount[1] * blockCount[2];
+    blockNodes.resize(blocks);
+    vertexOffset.assign(blocks + 1, 0);
+    triangleOffset.assign(blocks + 1, 0);
+    auto cancelled = [&]() { return token && token->isCancelled(); };
+    size_t vertexBase = vertices.size(), triangleBase = triangles.size();
+
+    dispatchVoxelType(settings.type, settings.data, [&](auto data) {
+        // 1. 构建每个块的八叉树，数出顶点
+#pragma omp parallel
+        {
+            BlockCache cache;
+#pragma omp for schedule(dynamic, 16)
+            for (int b = 0; b < blocks; b++) {
+                if (cancelled()) continue;
+                loadBlock(data, b, cache);
+                vertexOffset[b + 1] = buildBlock(cache, b);
+                reportBlock(b, blocks);
+            }
+        }
+        if (cancelled()) return;
+        for (int b = 0; b < blocks; b++) {
+            vertexOffset[b + 1] += vertexOffset[b];
+        }
+        resizeOutput(vertices, vertexBase + vertexOffset[blocks], Vertex(0, 0, 0, 0, 0, 1));
+
+        // 2. 算出顶点，数出三角形：找最小边要查相邻块的八叉树，所以在所有块都建好之后
+#pragma omp parallel
+        {
+            BlockCache cache;
+            float localMin[3], localMax[3];
+            for (int a = 0; a < 3; a++) {
+                localMin[a] = std::numeric_limits<float>::max();
+                localMax[a] = -std::numeric_limits<float>::max();
+            }
+#pragma omp for schedule(dynamic, 16)
+            for (int b = 0; b < blocks; b++) {
+                if (cancelled()) continue;
+                if (!blockNodes[b].empty()) {
+                    loadBlock(data, b, cache);
+                    computeVertices(cache, b, vertices.data() + vertexBase, localMin, localMax);
+                    triangleOffset[b + 1] = addTriangles(cache, b, nullptr);
+                }
+                reportBlock(b, blocks);
+            }
+#pragma omp critical
+            {
+                for (int a = 0; a < 3; a++) {
+                    bmin[a] = std::min(bmin[a], localMin[a]);
+                    bmax[a] = std::max(bmax[a], localMax[a]);
+                }
+            }
+        }
+        if (cancelled()) return;
+        for (int b = 0; b < blocks; b++) {
+            triangleOffset[b + 1] += triangleOffset[b];
+        }
+        resizeOutput(triangles, triangleBase + triangleOffset[blocks]);
+
+        // 3. 写入三角形
+#pragma omp parallel
+        {
+            BlockCache cache;
+#pragma omp for schedule(dynamic, 16)
+            for (int b = 0; b < blocks; b++) {
+                if (cancelled()) continue;
+                if (!blockNodes[b].empty()) {
+                    loadBlock(data, b, cache);
+                    addTriangles(cache, b, triangles.data() + triangleBase + triangleOffset[b]);
+                }
+                reportBlock(b, blocks);
+            }
+        }
+    });
+    if (cancelled()) return false;
+    // 三角形里面的下标是相对这一次输出的，最后统一加上 vertexBase
+    if (vertexBase > 0) {
+        int base = (int)vertexBase, count = triangleOffset[blocks];
+        std::array<int, 3>* output = triangles.data() + triangleBase;
+#pragma omp parallel for
+        for (int t = 0; t < count; t++) {
+            output[t][0] += base, output[t][1] += base, output[t][2] += base;
+        }
+    }
+    return true;
+}
+
+void AdaptiveOctree::reportBlock(int b, int blocks) const {
+    if (*progress && ((b + 1) % PROGRESS_BLOCKS == 0 || b + 1 == blocks)) (*progress)(b % PROGRESS_BLOCKS + 1, 3 * (int64_t)blocks);
+}
+
+template <typename T>
+void AdaptiveOctree::loadBlock(const T* data, int b, BlockCache& cache) const {
+    const auto& dim = settings->dim;
+    std::array<int, 3> origin = blockOrigin(b), begin, end;
+    for (int a = 0; a < 3; a++) {
+        cache.first[a] = origin[a] - 1;
+        begin[a] = std::max(cache.first[a], 0);
+        end[a] = std::min(cache.first[a] + BlockCache::SIZE, dim[a]);
+    }
+    for (int i = begin[0]; i < end[0]; i++) {
+        for (int j = begin[1]; j < end[1]; j++) {
+            const T* src = data + ((size_t)i * dim[1] + j) * dim[2];
+            float* row = cache.values + ((i - cache.first[0]) * BlockCache::SIZE + j - cache.first[1]) * BlockCache::SIZE + begin[2] - cache.first[2];
+            // 和 BrickExtractor::getData 一样
+            for (int k = begin[2]; k < end[2]; k++) {
+                float val = (float)src[k] - settings->isoValue;
+                row[k - begin[2]] = std::abs(val) < FLT_EPSILON ? FLT_EPSILON : val;
+            }
+            if (settings->closeBoundary) settings->capDataRow(i, j, begin[2], end[2], row);
+        }
+    }
+}
+
+int AdaptiveOctree::buildBlock(const BlockCache& cache, int b) {
+    std::vector<Node>& nodes = blockNodes[b];
+    nodes.clear();
+    std::array<int, 3> origin = blockOrigin(b);
+    // 大部分块离等值面很远，整个块只有一种正负性的话连根节点都不用建
+    if (getSign(cache, origin, BLOCK_SIZE) != 0) return 0;
+    nodes.push_back({-1, -1});
+    int vertexCount = 0;
+    struct Item {
+        int node;
+        std::array<int, 3> origin;
+        int size;
+    } stack[STACK_SIZE];
+    int top = 0;
+    stack[top++] = {0, origin, BLOCK_SIZE};
+    while (top > 0) {
+        Item item = stack[--top];
+        if (getSign(cache, item.origin, item.size) != 0) continue;
+        // 超出 box 的节点角上没有体素，不能合并，一直分到 box 里面的单个 cube
+        bool inside = true;
+        for (int a = 0; a < 3; a++) {
+            inside &= item.origin[a] + item.size <= hi[a];
+        }
+        if (item.size == 1 || (inside && isTrilinear(cache, item.origin, item.size) && isTopologicallySafe(cache, item.origin, item.size))) {
+            nodes[item.node].vertex = vertexCount++;
+            continue;
+        }
+        int first = nodes.size(), half = item.size / 2;
+        nodes[item.node].firstChild = first;
+        nodes.resize(first + 8, Node{-1, -1});
+        for (int c = 0; c < 8; c++) {
+            std::array<int, 3> child = {item.origin[0] + (c & 1) * half, item.origin[1] + ((c >> 1) & 1) * half, item.origin[2] + ((c >> 2) & 1) * half};
+            // 起点在 box 外面的子节点里面没有 cube，留作空的叶子
+            if (child[0] >= hi[0] || child[1] >= hi[1] || child[2] >= hi[2]) continue;
+            stack[top++] = {first + c, child, half};
+        }
+    }
+    return vertexCount;
+}
+
+int AdaptiveOctree::getSign(const BlockCache& cache, std::array<int, 3> origin, int size) const {
+    bool positive = false, negative = false;
+    for (int i = origin[0]; i <= std::min(origin[0] + size, hi[0]); i++) {
+        for (int j = origin[1]; j <= std::min(origin[1] + size, hi[1]); j++) {
+            for (int k = origin[2]; k <= std::min(origin[2] + size, hi[2]); k++) {
+                (cache.at(i, j, k) > 0 ? positive : negative) = true;
+            }
+            if (positive && negative) return 0;
+        }
+    }
+    return positive ? 1 : -1;
+}
+
+bool AdaptiveOctree::isTrilinear(const BlockCache& cache, std::array<int, 3> origin, int size) const {
+    float corner[8];
+    for (int c = 0; c < 8; c++) {
+        corner[c] = cache.at(origin[0] + (c & 1) * size, origin[1] + ((c >> 1) & 1) * size, origin[2] + ((c >> 2) & 1) * size);
+    }
+    for (int di = 0; di <= size; di++) {
+        float u = (float)di / size;
+        // 先沿 x 方向插值出 4 条 x = di 的棱上的值
+        float x00 = corner[0] + u * (corner[1] - corner[0]), x10 = corner[2] + u * (corner[3] - corner[2]);
+        float x01 = corner[4] + u * (corner[5] - corner[4]), x11 = corner[6] + u * (corner[7] - corner[6]);
+        for (int dj = 0; dj <= size; dj++) {
+            float v = (float)dj / size;
+            float y0 = x00 + v * (x10 - x00), y1 = x01 + v * (x11 - x01);
+            for (int dk = 0; dk <= size; dk++) {
+                float predicted = y0 + (float)dk / size * (y1 - y0);
+                float val = cache.at(origin[0] + di, origin[1] + dj, origin[2] + dk);
+                if (std::abs(val - predicted) > tolerance) return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool AdaptiveOctree::isTopologicallySafe(const BlockCache& cache, std::array<int, 3> origin, int size) const {
+    bool positive[8];
+    for (int c = 0; c < 8; c++) {
+        positive[c] = cache.at(origin[0] + (c & 1) * size, origin[1] + ((c >> 1) & 1) * size, origin[2] + ((c >> 2) & 1) * size) > 0;
+    }
+    for (int di = 0; di <= size; di++) {
+        for (int dj = 0; dj <= size; dj++) {
+            for (int dk = 0; dk <= size; dk++) {
+                int d[3] = {di, dj, dk};
+                bool sign = cache.at(origin[0] + di, origin[1] + dj, origin[2] + dk) > 0, found = false;
+                for (int c = 0; c < 8 && !found; c++) {
+                    // 在节点边界上的坐标只看同一侧的角，在中间的坐标两侧的角都看
+                    bool matches = positive[c] == sign;
+                    for (int a = 0; a < 3; a++) {
+                        if (d[a] == 0 || d[a] == size) matches &= ((c >> a) & 1) == (d[a] == size);
+                    }
+                    found = matches;
+                }
+                if (!found) return false;
+            }
+        }
+    }
+    for (int e = 0; e < 12; e++) {
+        int c0 = LEAF_EDGES[e][0], c1 = LEAF_EDGES[e][1], axis = e / 4;
+        if (positive[c0] == positive[c1]) continue;
+        int p[3];
+        for (int a = 0; a < 3; a++) {
+            p[a] = origin[a] + ((c0 >> a) & 1) * size;
+        }
+        int changes = 0;
+        bool last = positive[c0];
+        for (int t = 1; t <= size; t++) {
+            p[axis]++;
+            bool sign = cache.at(p[0], p[1], p[2]) > 0;
+            changes += sign != last;
+            last = sign;
+        }
+        if (changes > 1) return false;
+    }
+    return true;
+}
+
+template <typename F>
+void AdaptiveOctree::forEachActiveLeaf(int b, F visit) const {
+    const std::vector<Node>& nodes = blockNodes[b];
+    if (nodes.empty()) return;
+    struct Item {
+        int node;
+        std::array<int, 3> origin;
+        int size;
+    } stack[STACK_SIZE];
+    int top = 0;
+    stack[top++] = {0, blockOrigin(b), BLOCK_SIZE};
+    while (top > 0) {
+        Item item = stack[--top];
+        const Node& node = nodes[item.node];
+        if (node.firstChild < 0) {
+            if (node.vertex >= 0) visit(item.origin, item.size, vertexOffset[b] + node.vertex);
+            continue;
+        }
+        int half = item.size / 2;
+        for (int c = 7; c >= 0; c--) {
+            stack[top++] = {node.firstChild + c, {item.origin[0] + (c & 1) * half, item.origin[1] + ((c >> 1) & 1) * half, item.origin[2] + ((c >> 2) & 1) * half}, half};
+        }
+    }
+}
+
+int AdaptiveOctree::findLeaf(int x, int y, int z, int& vertex) const {
+    int p[3] = {x, y, z}, coord[3], origin[3];
+    for (int a = 0; a < 3; a++) {
+        coord[a] = (p[a] - lo[a]) / BLOCK_SIZE;
+        origin[a] = lo[a] + coord[a] * BLOCK_SIZE;
+    }
+    int b = blockIndex(coord[0], coord[1], coord[2]);
+    const std::vector<Node>& nodes = blockNodes[b];
+    vertex = -1;
+    if (nodes.empty()) return BLOCK_SIZE;
+    int n = 0, size = BLOCK_SIZE;
+    while (nodes[n].firstChild >= 0) {
+        size /= 2;
+        int c = 0;
+        for (int a = 0; a < 3; a++) {
+            if (p[a] >= origin[a] + size) {
+                c |= 1 << a;
+                origin[a] += size;
+            }
+        }
+        n = nodes[n].firstChild + c;
+    }
+    if (nodes[n].vertex >= 0) vertex = vertexOffset[b] + nodes[n].vertex;
+    return size;
+}
+
+void AdaptiveOctree::computeVertices(const BlockCache& cache, int b, Vertex* vertices, float bmin[3], float bmax[3]) const {
+    const auto& spacing = settings->spacing;
+    forEachActiveLeaf(b, [&](std::array<int, 3> origin, int size, int vertex) {
+        // 叶子里面的值是 8 个角的三线性插值，沿着边就是线性插值，和 Surface Nets 一样取边上插值点的平均
+        int corner[8][3];
+        float value[8];
+        std::array<float, 3> normal[8];
+        for (int c = 0; c < 8; c++) {
+            for (int a = 0; a < 3; a++) {
+                corner[c][a] = origin[a] + ((c >> a) & 1) * size;
+            }
+            value[c] = cache.at(corner[c][0], corner[c][1], corner[c][2]);
+        }
+        // 只有跨过等值面的边的端点用到法线
+        for (int c = 0; c < 8; c++) {
+            bool positive = value[c] > 0;
+            if (positive != (value[c ^ 1] > 0) || positive != (value[c ^ 2] > 0) || positive != (value[c ^ 4] > 0)) {
+                normal[c] = getNormal(cache, corner[c][0], corner[c][1], corner[c][2]);
+            }
+        }
+        float position[3] = {0, 0, 0}, normalSum[3] = {0, 0, 0};
+        int crossings = 0;
+        for (int e = 0; e < 12; e++) {
+            int c0 = LEAF_EDGES[e][0], c1 = LEAF_EDGES[e][1];
+            if ((value[c0] > 0) == (value[c1] > 0)) continue;
+            float ratio = value[c0] / (value[c0] - value[c1]);
+            for (int a = 0; a < 3; a++) {
+                position[a] += (corner[c0][a] + ratio * (corner[c1][a] - corner[c0][a])) * spacing[a];
+                normalSum[a] += normal[c0][a] + ratio * (normal[c1][a] - normal[c0][a]);
+            }
+            crossings++;
+        }
+        // isTopologicallySafe 保证有顶点的叶子的角上一定有正有负
+        assert(crossings > 0);
+        for (int a = 0; a < 3; a++) {
+            position[a] /= crossings, normalSum[a] /= crossings;
+            bmin[a] = std::min(bmin[a], position[a]);
+            bmax[a] = std::max(bmax[a], position[a]);
+        }
+        // 大的叶子的角离等值面远，角上的差分法线可能全是 0（比如角上正好是一个体素的凹坑），这时用叶子里面三线性插值的梯度
+        if (normalSum[0] == 0 && normalSum[1] == 0 && normalSum[2] == 0) {
+            std::array<float, 3> normal = getTrilinearNormal(value, origin, size, position);
+            normalSum[0] = normal[0], normalSum[1] = normal[1], normalSum[2] = normal[2];
+        }
+        vertices[vertex] = Vertex(position[0], position[1], position[2], normalSum[0], normalSum[1], normalSum[2]);
+    });
+}
+
+int AdaptiveOctree::addTriangles(const BlockCache& cache, int b, std::array<int, 3>* triangles) const {
+    int count = 0;
+    forEachActiveLeaf(b, [&](std::array<int, 3> origin, int size, int vertex) {
+        for (int e = 0; e < 12; e++) {
+            int axis = e / 4, u = (axis + 1) % 3, v = (axis + 2) % 3, c0 = LEAF_EDGES[e][0];
+            int p[3];
+            for (int a = 0; a < 3; a++) {
+                p[a] = origin[a] + ((c0 >> a) & 1) * size;
+            }
+            int p1[3] = {p[0], p[1], p[2]};
+            p1[axis] += size;
+            bool positive = cache.at(p[0], p[1], p[2]) > 0;
+            if (positive == (cache.at(p1[0], p1[1], p1[2]) > 0)) continue;
+            // 围着这条边的 4 个格子所在的叶子，有比这个叶子小的说明这条边不是最小边，由更小的叶子负责；
+            // 一样大的叶子共用这条边，由第一个一样大的叶子负责，这样每条最小边只输出一次
+            int quad[4];
+            bool owned = true, first = true;
+            for (int c = 0; c < 4 && owned; c++) {
+                int q[3] = {p[0], p[1], p[2]};
+                q[u] += QUAD_CELLS[c][0], q[v] += QUAD_CELLS[c][1];
+                if (q[u] < lo[u] || q[u] >= hi[u] || q[v] < lo[v] || q[v] >= hi[v]) {
+                    // box 边界上周围不够 4 个格子的边不连
+                    owned = false;
+                    break;
+                }
+                // 这个叶子自己占的格子不用查：c0 在 u 方向上是叶子的上边界的话叶子在 -1 一侧
+                bool self = QUAD_CELLS[c][0] == -((c0 >> u) & 1) && QUAD_CELLS[c][1] == -((c0 >> v) & 1);
+                int leafSize = self ? size : findLeaf(q[0], q[1], q[2], quad[c]);
+                if (self) quad[c] = vertex;
+                if (leafSize < size || quad[c] < 0) owned = false;
+                if (leafSize == size && first) {
+                    owned &= quad[c] == vertex;
+                    first = false;
+                }
+            }
+            if (!owned) continue;
+            // 同一个叶子占了相邻的两个格子的话四边形退化成三角形
+            int polygon[4], n = 0;
+            for (int c = 0; c < 4; c++) {
+                if (n == 0 || polygon[n - 1] != quad[c]) polygon[n++] = quad[c];
+            }
+            if (n > 1 && polygon[n - 1] == polygon[0]) n--;
+            for (int t = 1; t + 1 < n; t++) {
+                // 朝向和 FlyingEdges 的 Surface Nets 一样
+                if (triangles) {
+                    triangles[count] = positive ? std::array<int, 3>{polygon[0], polygon[t + 1], polygon[t]} : std::array<int, 3>{polygon[0], polygon[t], polygon[t + 1]};
+                }
+                count++;
+            }
+        }
+    });
+    return count;
+}
+
+std::array<float, 3> AdaptiveOctree::getTrilinearNormal(const float value[8], std::array<int, 3> origin, int size, const float position[3]) const {
+    const auto& spacing = settings->spacing;
+    float d = settings->reverseGradientDirection ? -1 : 1;
+    // 叶子里面的局部坐标 [0, 1]
+    float t[3];
+    for (int a = 0; a < 3; a++) {
+        t[a] = (position[a] / spacing[a] - origin[a]) / size;
+    }
+    std::array<float, 3> normal = {0, 0, 0};
+    for (int c = 0; c < 8; c++) {
+        for (int a = 0; a < 3; a++) {
+            // 对 t[a] 求导：第 a 个方向上的权重换成 ±1，其他方向不变
+            float weight = ((c >> a) & 1) ? 1.f : -1.f;
+            for (int b = 0; b < 3; b++) {
+                if (b != a) weight *= ((c >> b) & 1) ? t[b] : 1 - t[b];
+            }
+            normal[a] += weight * value[c];
+        }
+    }
+    for (int a = 0; a < 3; a++) {
+        normal[a] *= d / (size * spacing[a]);
+    }
+    return normal;
+}
+
+std::array<float, 3> AdaptiveOctree::getNormal(const BlockCache& cache, int i, int j, int k) const {
+    const auto& dim = settings->dim;
+    const auto& spacing = settings->spacing;
+    float d = settings->reverseGradientDirection ? -1 : 1;
+    int p[3] = {i, j, k};
+    std::array<float, 3> normal;
+    // 边界上用单侧差分
+    for (int a = 0; a < 3; a++) {
+        int p0[3] = {i, j, k}, p1[3] = {i, j, k};
+        float divisor = spacing[a];
+        if (p[a] == 0) {
+            p1[a]++;
+        } else if (p[a] == dim[a] - 1) {
+            p0[a]--;
+        } else {
+            p0[a]--, p1[a]++;
+            divisor = 2 * spacing[a];
+        }
+        normal[a] = (cache.at(p1[0], p1[1], p1[2]) - cache.at(p0[0], p0[1], p0[2])) / divisor * d;
+    }
+    return normal;
+}
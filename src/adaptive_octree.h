@@ -0,0 +1,111 @@
+﻿#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "brick_extractor.h"
+#include "cancellation_token.h"
+#include "vertex.h"
+
+/**
+ * \brief 自适应分辨率的提取（ALGORITHM_ADAPTIVE）：在八叉树的叶子上做 Surface Nets
+ *
+ * box 里面的 cube 切成边长为 BLOCK_SIZE 的块，每个块是一棵八叉树，从整个块开始往下分：
+ * 体素全为正或全为负的节点里面没有等值面，直接作为叶子；否则如果节点里面每个体素的值和用节点 8 个角插值（三线性插值）的结果
+ * 相差不超过 tolerance，并且节点里面的正负性变化都能从 8 个角上看出来（见 isTopologicallySafe），就不再往下分，
+ * 整个节点作为一个叶子，否则分成 8 个子节点，最小分到单个 cube。
+ * 平坦的地方叶子大，三角形少；弯曲的地方叶子小，和 ALGORITHM_SURFACE_NETS 一样细。
+ *
+ * 和 Surface Nets 一样，每个和等值面相交的叶子一个顶点（叶子的 12 条边上线性插值点的平均），每条跨过等值面的最小边
+ * （周围的叶子里面最小的那个叶子的边）在周围的叶子之间连一个四边形，周围有两个格子在同一个叶子里面的话退化成三角形。
+ * 不同大小的叶子之间不需要特殊的过渡 cube：四边形直接连在大小不同的叶子的顶点上，网格本身就是连起来的，不会有裂缝。
+ * 叶子里面的等值面被当作三线性插值的等值面，离体素值的偏差不超过 tolerance，比 tolerance 还薄的细节可能被合并掉。
+ * 和 FlyingEdges 一样先计数、求前缀和，一次分配好输出再并行写入；八叉树全部建好之后只读，块之间不用同步。
+ */
+class AdaptiveOctree {
+   public:
+    // 叶子最大的边长（按 cube 计）
+    static const int BLOCK_SIZE = 8;
+    /**
+     * \brief 提取 settings.box 里面的等值面，追加到 vertices、triangles 后面，bounding box 合并到 bmin、bmax 中
+     * \param tolerance 合并叶子时允许的插值误差，和体数据的单位相同，为 0 的话只合并完全是三线性的区域
+     * \param progress 不为空的话，逐块的 3 遍每做完 PROGRESS_BLOCKS 个块报告一次，总工作量是 3 倍的块数
+     * \return 被取消的话返回 false，这时 vertices、triangles 的内容不完整
+     */
+    bool extract(const BrickExtractor::Settings& settings, float tolerance, const CancellationToken* token, const WorkProgressCallback& progress, std::vector<Vertex>& vertices, std::vector<std::array<int, 3>>& triangles, float bmin[3], float bmax[3]);
+    static const int PROGRESS_BLOCKS = 16;
+
+   private:
+    const BrickExtractor::Settings* settings;
+    const WorkProgressCallback* progress;
+    // 第 b 个块做完之后调用，和 FlyingEdges::reportRow 一样按 PROGRESS_BLOCKS 个块一组报告
+    void reportBlock(int b, int blocks) const;
+    float tolerance;
+    // box 的体素范围 [lo, hi]，块 (bi, bj, bk) 的 cube 范围从 lo + (bi, bj, bk) * BLOCK_SIZE 开始
+    std::array<int, 3> lo, hi, blockCount;
+    // 八叉树的节点，子节点连续存放，叶子的 firstChild 为 -1；vertex 是叶子在所在块中的顶点编号，没有顶点的为 -1
+    struct Node {
+        int firstChild;
+        int vertex;
+    };
+    // 每个块的节点，第 0 个是根节点；体素全为正或者全为负的块是空的
+    std::vector<std::vector<Node>> blockNodes;
+    // 每个块的顶点、三角形在这一次输出中的偏移，最后一个元素是总数
+    std::vector<int> vertexOffset, triangleOffset;
+
+    inline int blockIndex(int bi, int bj, int bk) const {
+        return (bi * blockCount[1] + bj) * blockCount[2] + bk;
+    }
+    inline std::array<int, 3> blockOrigin(int b) const {
+        return {lo[0] + b / (blockCount[1] * blockCount[2]) * BLOCK_SIZE, lo[1] + b / blockCount[2] % blockCount[1] * BLOCK_SIZE, lo[2] + b % blockCount[2] * BLOCK_SIZE};
+    }
+    /**
+     * \brief 一个块用到的数据值，每个线程一个
+     *
+     * 块的体素范围 [origin, origin + BLOCK_SIZE] 两侧各多一个体素用来求法线，值按 getData 的方式处理过，
+     * 构建八叉树时每个体素要读好几遍，先转成 float 存起来，之后都不用再读原始数据
+     */
+    struct BlockCache {
+        static const int SIZE = BLOCK_SIZE + 3;
+        std::array<int, 3> first;
+        float values[SIZE * SIZE * SIZE];
+        inline float at(int i, int j, int k) const {
+            return values[((i - first[0]) * SIZE + j - first[1]) * SIZE + k - first[2]];
+        }
+    };
+    // 读取第 b 个块的数据，体数据外面的部分不填
+    template <typename T>
+    void loadBlock(const T* data, int b, BlockCache& cache) const;
+    /**
+     * \brief 构建第 b 个块的八叉树，返回这个块的顶点数
+     */
+    int buildBlock(const BlockCache& cache, int b);
+    // 节点 (origin, size) 的所有体素是否可以用 8 个角三线性插值代替，见类的说明
+    bool isTrilinear(const BlockCache& cache, std::array<int, 3> origin, int size) const;
+    /**
+     * \brief 合并成一个叶子之后拓扑不会变：每个体素的正负性在包含它的最小的棱、面或者整个节点的角上出现过，
+     * 两端正负性不同的棱上只跨过一次等值面
+     * 比如 8 个角都为正、里面有一个为负的体素，三线性插值的误差可能不超过 tolerance，但是合并之后叶子的棱上没有交点，算不出顶点
+     */
+    bool isTopologicallySafe(const BlockCache& cache, std::array<int, 3> origin, int size) const;
+    // 节点里面体素的正负性：1 全为正，-1 全为负，0 两种都有，只看在 box 里面的体素
+    int getSign(const BlockCache& cache, std::array<int, 3> origin, int size) const;
+    /**
+     * \brief 依次访问第 b 个块中有顶点的叶子，visit(origin, size, vertex)，vertex 是全局的顶点编号
+     */
+    template <typename F>
+    void forEachActiveLeaf(int b, F visit) const;
+    // 包含 cube (x, y, z) 的叶子：返回叶子的边长，vertex 为它全局的顶点编号，没有顶点的话为 -1
+    int findLeaf(int x, int y, int z, int& vertex) const;
+    // 第 b 个块的叶子的顶点
+    void computeVertices(const BlockCache& cache, int b, Vertex* vertices, float bmin[3], float bmax[3]) const;
+    /**
+     * \brief 第 b 个块的叶子拥有的最小边上的三角形，triangles 为空的话只计数，返回三角形数
+     */
+    int addTriangles(const BlockCache& cache, int b, std::array<int, 3>* triangles) const;
+    // 和 BrickExtractor::computeNormalRow 一样的差分法线
+    std::array<float, 3> getNormal(const BlockCache& cache, int i, int j, int k) const;
+    // 叶子 (origin, size) 里面 8 个角的值为 value 的三线性插值在 position（实际坐标）处的梯度，方向和 getNormal 一致
+    std::array<float, 3> getTrilinearNormal(const float value[8], std::array<int, 3> origin, int size, const float position[3]) const;
+};
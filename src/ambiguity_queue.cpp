@@ -0,0 +1,293 @@
+﻿#include "ambiguity_queue.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+
+#include "LookUpTable.h"
+
+// 每个面做渐近线测试所用的四个角点 ABCD
+// 参考 Figure 6 第 3 个图，这个顺序 ABCD 的应该是作者自己确定的，论文里面没写，这个顺序跟测试是否带正负号相关
+// 原来的顺序从相邻的两个 cube 看同一个面的时候不一样，第 2, 3 个面的 A 和 D 互换，B 和 C 互换了（有歧义的面上 A 和 D 异号，结果的符号不变），
+// 这里统一用第 i + 1 层和第 j + 1 行的 cube 看到的顺序（第 5, 6 个面本来就一致），这样两边算出来的结果完全相同
+static const int faceCorners[6][4] = {
+    {0, 4, 5, 1},
+    {2, 6, 5, 1},
+    {3, 7, 6, 2},
+    {3, 7, 4, 0},
+    {0, 3, 2, 1},
+    {4, 7, 6, 5},
+};
+
+// 内部测试沿着 edgeIdx 这条边的方向切 cube：t 由这条边的两个端点 {0, 1} 插值得到，
+// Bt, Ct, Dt 分别在 {2, 3}, {4, 5}, {6, 7} 两个角点之间按 t 插值，At 就在等值面上，总是 0
+static const int interiorEdgeCorners[12][8] = {
+    {0, 1, 3, 2, 7, 6, 4, 5},
+    {1, 2, 0, 3, 4, 7, 5, 6},
+    {2, 3, 1, 0, 5, 4, 6, 7},
+    {3, 0, 2, 1, 6, 5, 7, 4},
+    {4, 5, 7, 6, 3, 2, 0, 1},
+    {5, 6, 4, 7, 0, 3, 1, 2},
+    {6, 7, 5, 4, 1, 0, 2, 3},
+    {7, 4, 6, 5, 2, 1, 3, 0},
+    {0, 4, 3, 7, 2, 6, 1, 5},
+    {1, 5, 0, 4, 3, 7, 2, 6},
+    {2, 6, 1, 5, 0, 4, 3, 7},
+    {3, 7, 2, 6, 1, 5, 0, 4},
+};
+
+// At, Bt, Ct, Dt 的正负性组成的 test 值对应的结果：乘在 alongEdgeIdx 上的符号，以及是否还要乘上 At * Ct - Bt * Dt（5 和 10）
+static const int interiorSign[16] = {-1, -1, -1, -1, -1, 1, -1, 1, -1, -1, -1, 1, -1, 1, 1, 1};
+static const bool interiorUseDeterminant[16] = {false, false, false, false, false, true, false, false, false, false, true, false, false, false, false, false};
+
+void AmbiguityQueue::clear() {
+    for (auto& batch : batches) {
+        batch.cells.clear();
+        batch.configurations.clear();
+        for (auto& corner : batch.corners) {
+            corner.clear();
+        }
+    }
+}
+
+void AmbiguityQueue::push(int cell, int caseIdx, int configurationIndexInCase, const float cube[8]) {
+    Batch& batch = batches[caseIdx];
+    batch.cells.push_back(cell);
+    batch.configurations.push_back(configurationIndexInCase);
+    for (int l = 0; l < 8; l++) {
+        batch.corners[l].push_back(cube[l]);
+    }
+}
+
+void AmbiguityQueue::resolve(int i, std::vector<ActiveCell>& activeCells, FaceDecisionCache* faceCache) {
+    for (int caseIdx = 0; caseIdx < 15; caseIdx++) {
+        Batch& batch = batches[caseIdx];
+        int count = batch.cells.size();
+        if (count == 0) continue;
+        // case 4 只需要内部测试
+        if (caseIdx != 4) {
+            if (faceCache) {
+                computeFaces(batch, caseIdx, i, activeCells, *faceCache);
+            } else {
+                computeFaces(batch);
+            }
+        }
+        // case 13 的内部测试参数依赖于面测试的结果，在 selectSubcase 里面单独算
+        if (caseIdx != 3 && caseIdx != 13) computeInteriors(batch, caseIdx);
+        for (int n = 0; n < count; n++) {
+            activeCells[batch.cells[n]].subcase = selectSubcase(batch, n, caseIdx);
+        }
+    }
+}
+
+void AmbiguityQueue::computeFaces(Batch& batch) {
+    int count = batch.cells.size();
+    for (int f = 0; f < 6; f++) {
+        const float* A = batch.corners[faceCorners[f][0]].data();
+        const float* B = batch.corners[faceCorners[f][1]].data();
+        const float* C = batch.corners[faceCorners[f][2]].data();
+        const float* D = batch.corners[faceCorners[f][3]].data();
+        batch.faces[f].resize(count);
+        float* face = batch.faces[f].data();
+        for (int n = 0; n < count; n++) {
+            face[n] = A[n] * (A[n] * C[n] - B[n] * D[n]);
+        }
+    }
+}
+
+void AmbiguityQueue::computeFaces(Batch& batch, int caseIdx, int i, const std::vector<ActiveCell>& activeCells, FaceDecisionCache& faceCache) {
+    int count = batch.cells.size();
+    for (int f = 0; f < 6; f++) {
+        batch.faces[f].resize(count);
+    }
+    for (int n = 0; n < count; n++) {
+        const ActiveCell& cell = activeCells[batch.cells[n]];
+        int c = batch.configurations[n];
+        // 只测试这种 configuration 用到的面
+        const char* tests;
+        int testCount;
+        switch (caseIdx) {
+            case 3:
+                tests = &test3[c], testCount = 1;
+                break;
+            case 6:
+                tests = test6[c], testCount = 1;
+                break;
+            case 7:
+                tests = test7[c], testCount = 3;
+                break;
+            case 10:
+                tests = test10[c], testCount = 2;
+                break;
+            case 12:
+                tests = test12[c], testCount = 2;
+                break;
+            default:
+                tests = test13[c], testCount = 6;
+                break;
+        }
+        for (int t = 0; t < testCount; t++) {
+            int f = std::abs(tests[t]) - 1;
+            signed char& sign = faceCache.decision(i, cell.j, cell.k, f);
+            if (sign == FaceDecisionCache::UNKNOWN) {
+                float A = batch.corners[faceCorners[f][0]][n], B = batch.corners[faceCorners[f][1]][n];
+                float C = batch.corners[faceCorners[f][2]][n], D = batch.corners[faceCorners[f][3]][n];
+                float face = A * (A * C - B * D);
+                sign = (face > 0) - (face < 0);
+            }
+            batch.faces[f][n] = sign;
+        }
+    }
+}
+
+void AmbiguityQueue::computeInteriors(Batch& batch, int caseIdx) {
+    int count = batch.cells.size();
+    batch.interiors.resize(count);
+    for (int n = 0; n < count; n++) {
+        int c = batch.configurations[n];
+        int alongEdgeIdx, edgeIdx;
+        switch (caseIdx) {
+            // 4 和 10 的 edgeIdx 不重要，因为其强的对称性
+            case 4:
+                alongEdgeIdx = test4[c], edgeIdx = 1;
+                break;
+            case 6:
+                alongEdgeIdx = test6[c][1], edgeIdx = test6[c][2];
+                break;
+            case 7:
+                alongEdgeIdx = test7[c][3], edgeIdx = test7[c][4];
+                break;
+            case 10:
+                alongEdgeIdx = test10[c][2], edgeIdx = 1;
+                break;
+            default:
+                alongEdgeIdx = test12[c][2], edgeIdx = test12[c][3];
+                break;
+        }
+        batch.interiors[n] = testInterior(batch, n, caseIdx, alongEdgeIdx, edgeIdx);
+    }
+}
+
+float AmbiguityQueue::testInterior(const Batch& batch, int n, int caseIdx, int alongEdgeIdx, int edgeIdx) const {
+    auto cube = [&](int l) { return batch.corners[l][n]; };
+    float t, At = 0, Bt = 0, Ct = 0, Dt = 0, a, b;
+    if (caseIdx == 4 || caseIdx == 10) {
+        // 强对称性，直接计算
+        a = (cube(4) - cube(0)) * (cube(6) - cube(2)) - (cube(7) - cube(3)) * (cube(5) - cube(1));
+        b = cube(2) * (cube(4) - cube(0)) + cube(0) * (cube(6) - cube(2)) - cube(1) * (cube(7) - cube(3)) - cube(3) * (cube(5) - cube(1));
+        t = -b / (2 * a);
+        if (t > 0 || t < 1) return -alongEdgeIdx;
+        At = cube(0) + (cube(4) - cube(0)) * t;
+        Bt = cube(3) + (cube(7) - cube(3)) * t;
+        Ct = cube(2) + (cube(6) - cube(2)) * t;
+        Dt = cube(1) + (cube(5) - cube(1)) * t;
+    } else {
+        // 没有强对称性，根据 edgeIdx 计算
+        if (edgeIdx < 0 || edgeIdx > 11) {
+            std::cout << "testInterior got wrong edgeIdx: " << edgeIdx << std::endl;
+            assert(false);
+            return -alongEdgeIdx;
+        }
+        const int* e = interiorEdgeCorners[edgeIdx];
+        t = cube(e[0]) / (cube(e[0]) - cube(e[1]));
+        Bt = cube(e[2]) + (cube(e[3]) - cube(e[2])) * t;
+        Ct = cube(e[4]) + (cube(e[5]) - cube(e[4])) * t;
+        Dt = cube(e[6]) + (cube(e[7]) - cube(e[6])) * t;
+    }
+
+    int test = (At >= 0) + (Bt >= 0) * 2 + (Ct >= 0) * 4 + (Dt >= 0) * 8;
+    float result = interiorSign[test] * alongEdgeIdx;
+    return interiorUseDeterminant[test] ? (At * Ct - Bt * Dt) * result : result;
+}
+
+unsigned char AmbiguityQueue::selectSubcase(const Batch& batch, int n, int caseIdx) const {
+    int c = batch.configurations[n];
+    // subconfig 由多个 face 测试的二进制表示
+    int subconfig = 0, subconfig13Value;
+    // 参考 Table 1: A reduced representation of the test table. Case 13 has 45 entries to map the results of all the possible tests to the right subcase.
+    // 子类编号的含义见 tiling_table.h
+    switch (caseIdx) {
+        // 3. 需要对 1 个面进行测试，- 使用 3.1（2 个三角形），+ 使用 3.2（4 个三角形）
+        case 3:
+            return batch.face(test3[c], n) < 0 ? 0 : 1;
+        // 4. 需要对 1 个 interior 进行测试，- 使用 4.1（2 个三角形），+ 使用 4.2（6 个三角形） （论文的  table 1 写错了，应该写在 interior 的测试写在了 face 上）
+        case 4:
+            return batch.interiors[n] < 0 ? 0 : 1;
+        // 6: 需要测试 1 个面，同时测试 1 个 interior
+        case 6:
+            if (batch.face(test6[c][0], n) < 0) {
+                // 6.1.1: 3 个三角形，6.1.2: 9 个三角形（论文里面错写成 7 了）
+                return batch.interiors[n] < 0 ? 0 : 1;
+            }
+            // 6.2: 5 个三角形
+            return 2;
+        // 7: 需要测试 3 个面，同时测试 1 个 interior
+        case 7: {
+            for (int f = 0; f < 3; f++) {
+                if (batch.face(test7[c][f], n) < 0) {
+                    subconfig += 1 << f;
+                }
+            }
+            // 0: 7.1，3 个三角形
+            // 1, 2, 4: 7.2，5 个三角形
+            // 3, 5, 6: 7.3，9 个三角形，6 需要 v12
+            // 7: 7.4.1（5 个三角形，论文里面写成 9 是错了）或 7.4.2（9 个三角形）
+            static const unsigned char subcase7[8] = {0, 1, 2, 4, 3, 5, 6, 7};
+            if (subconfig == 7 && batch.interiors[n] <= 0) {
+                return 8;
+            }
+            return subcase7[subconfig];
+        }
+        // 10: 测试 2 个面，1 个 interior
+        // 12: 跟 10 一样的套路
+        case 10:
+        case 12: {
+            const char* test = caseIdx == 10 ? test10[c] : test12[c];
+            if (batch.face(test[0], n) > 0) {
+                subconfig += 1;
+            }
+            if (batch.face(test[1], n) > 0) {
+                subconfig += 2;
+            }
+            // 0: x.1.1（4 个三角形）或 x.1.2（8 个三角形），由内部测试决定，10 的 edgeIdx 不重要，12 的需要
+            // 1, 2: x.2，8 个三角形，v12
+            // 3: x.1.1，4 个三角形
+            if (subconfig == 0) {
+                return batch.interiors[n] < 0 ? 0 : 1;
+            }
+            return subconfig + 1;
+        }
+        // 13: 最为特殊的例子，有一个专门的 subconfig13 来存储配置映射信息，需要测试 6 个面和 1 个 interior
+        case 13:
+            for (int f = 0; f < 6; f++) {
+                if (batch.face(test13[c][f], n) > 0) {
+                    subconfig += 1 << f;
+                }
+            }
+            subconfig13Value = subconfig13[subconfig];
+            // subconfig13 中其实负数出现，表示这种情况是一定不会出现的
+            if (subconfig13Value < 0 || subconfig13Value > 45) {
+                std::cout << "case 13 subconfig should in range(0, 46)" << std::endl;
+                assert(false);
+                return INVALID_SUBCASE;
+            }
+            if (subconfig13Value <= 22) {
+                // 13.1, 13.2, 13.3, 13.4 的子类编号就是 subconfig13Value
+                return subconfig13Value;
+            }
+            if (subconfig13Value <= 26) {
+                // 13.5
+                // 这个的 edgeIdx 比较特殊，是从 tiling13_5_1 里面拿的
+                if (testInterior(batch, n, caseIdx, test13[c][6], tiling13_5_1[c][subconfig13Value - 23][0]) >= 0) {
+                    return subconfig13Value + 4;
+                }
+                return subconfig13Value;
+            }
+            // 13.3_, 13.2_, 13.1_ 排在 13.5.2 之后
+            return subconfig13Value + 4;
+        default:
+            std::cout << "case number should in range(0, 15)" << std::endl;
+            assert(false);
+            return INVALID_SUBCASE;
+    }
+}
@@ -0,0 +1,58 @@
+﻿#pragma once
+
+#include <vector>
+
+#include "face_decision_cache.h"
+#include "sign_volume.h"
+
+/**
+ * \brief 延迟到整块 cube 分类完之后再批量做的歧义测试
+ *
+ * case 3, 4, 6, 7, 10, 12, 13 需要面测试（asymptotic decider）或内部测试才能确定子类。
+ * 分类的时候只把这些 cube 放进各自 case 的队列，8 个角点的值按 SoA 存放（corners[l][n] 是第 n 个 cube 的第 l 个角点），
+ * 然后按 case 一次处理整个队列：6 个面的测试对所有 cube 都算，是没有分支的连续循环，可以被编译器向量化；
+ * 内部测试用查表代替原来按 edgeIdx 的 switch。最后把子类编号写回 ActiveCell::subcase。
+ */
+class AmbiguityQueue {
+   public:
+    // 子类编号非法（subconfig13 中不会出现的组合），这个 cube 不生成三角形
+    static const unsigned char INVALID_SUBCASE = 255;
+    // caseIdx 这一大类是否需要测试才能确定子类
+    static inline bool needsTest(int caseIdx) {
+        return (1 << caseIdx) & ((1 << 3) | (1 << 4) | (1 << 6) | (1 << 7) | (1 << 10) | (1 << 12) | (1 << 13));
+    }
+    // 清空所有队列，保留容量
+    void clear();
+    /**
+     * \brief 把一个需要测试的 cube 放进对应 case 的队列
+     * \param cell 在 activeCells 中的下标
+     * \param cube 8 个角点的值，顺序和 MarchingCubes 中的 cube 编号一致
+     */
+    void push(int cell, int caseIdx, int configurationIndexInCase, const float cube[8]);
+    /**
+     * \brief 批量测试第 i 层所有队列中的 cube，把子类编号写回 activeCells[cell].subcase
+     * \param faceCache 不为空的话面测试的结果和相邻的 cube 共用，只测试用到的面
+     */
+    void resolve(int i, std::vector<ActiveCell>& activeCells, FaceDecisionCache* faceCache = nullptr);
+
+   private:
+    struct Batch {
+        std::vector<int> cells;
+        std::vector<unsigned char> configurations;
+        std::vector<float> corners[8];
+        // 第 f + 1 个面的 asymptotic decider（f 为正时的符号），带符号的面编号为负时取反，使用 FaceDecisionCache 时只有符号
+        std::vector<float> faces[6];
+        // 预先按照 LookUpTable 中的参数算好的内部测试结果，case 13 只有 13.5 需要，单独算
+        std::vector<float> interiors;
+        inline float face(int f, int n) const {
+            return f > 0 ? faces[f - 1][n] : -faces[-f - 1][n];
+        }
+    };
+    // 按 caseIdx 下标，只有 needsTest 的 case 会用到
+    Batch batches[15];
+    void computeFaces(Batch& batch);
+    void computeFaces(Batch& batch, int caseIdx, int i, const std::vector<ActiveCell>& activeCells, FaceDecisionCache& faceCache);
+    void computeInteriors(Batch& batch, int caseIdx);
+    float testInterior(const Batch& batch, int n, int caseIdx, int alongEdgeIdx, int edgeIdx) const;
+    unsigned char selectSubcase(const Batch& batch, int n, int caseIdx) const;
+};
@@ -0,0 +1,43 @@
+﻿#include "benchmark.h"
+
+#include <omp.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+
+#include "marching_cubes.h"
+
+void runBenchmark(const unsigned short* data, std::array<int, 3> dim, std::array<float, 3> spacing, const std::vector<float>& isoValues, int repeats) {
+    const MarchingAlgorithm algorithms[] = {ALGORITHM_MC33, ALGORITHM_CLASSIC, ALGORITHM_FLYING_EDGES, ALGORITHM_SURFACE_NETS, ALGORITHM_ADAPTIVE};
+    const char* names[] = {"MC33", "classic", "flying edges", "surface nets", "adaptive"};
+    const int count = sizeof(algorithms) / sizeof(algorithms[0]);
+    struct Result {
+        double secs;
+        size_t vertices, triangles;
+    };
+    std::vector<Result> results;
+    for (float isoValue : isoValues) {
+        for (int a = 0; a < count; a++) {
+            Result result{std::numeric_limits<double>::max(), 0, 0};
+            for (int r = 0; r < repeats; r++) {
+                MarchingCubes mc(data, dim, spacing, true);
+                mc.algorithm = algorithms[a];
+                double start = omp_get_wtime();
+                mc.runAlgorithm(isoValue);
+                result.secs = std::min(result.secs, omp_get_wtime() - start);
+                result.vertices = mc.getVertices().size(), result.triangles = mc.getTriangles().size();
+            }
+            results.push_back(result);
+        }
+    }
+
+    // runAlgorithm 自己也会打印，汇总放在最后
+    printf("\n%-14s %10s %12s %12s %12s %10s\n", "algorithm", "isoValue", "secs", "vertices", "triangles", "speedup");
+    for (int s = 0; s < isoValues.size(); s++) {
+        const Result* row = &results[s * count];
+        for (int a = 0; a < count; a++) {
+            printf("%-14s %10.1f %12.4f %12zu %12zu %9.2fx\n", names[a], isoValues[s], row[a].secs, row[a].vertices, row[a].triangles, row[0].secs / row[a].secs);
+        }
+    }
+}
@@ -0,0 +1,11 @@
+﻿#pragma once
+
+#include <array>
+#include <vector>
+
+/**
+ * \brief 在同一个体数据上比较各个 MarchingAlgorithm 的提取时间和输出大小，结果打印到标准输出
+ * 每个等值面、每种算法运行 repeats 次取最快的一次，每次都是新的 MarchingCubes，不会复用上一次的结果；
+ * 构造 MarchingCubes（构建 min/max 八叉树）的时间不算在里面
+ */
+void runBenchmark(const unsigned short* data, std::array<int, 3> dim, std::array<float, 3> spacing, const std::vector<float>& isoValues, int repeats = 3);
@@ -0,0 +1,465 @@
+﻿#include "brick_extractor.h"
+
+#include <cassert>
+#include <iostream>
+
+#include "LookUpTable.h"
+#include "simd.h"
+#include "tiling_table.h"
+
+void BrickExtractor::extract(const Settings& settings, const BrickGrid& grid, int brick, BrickMesh& mesh) {
+    outputMode = OUTPUT_MESH, this->mesh = &mesh;
+    mesh.clear();
+    run(settings, grid, brick);
+}
+
+void BrickExtractor::count(const Settings& settings, const BrickGrid& grid, int brick, int& vertexCount, int& triangleCount) {
+    outputMode = OUTPUT_COUNT, mesh = nullptr;
+    this->vertexCount = 0, this->triangleCount = 0;
+    run(settings, grid, brick);
+    vertexCount = this->vertexCount, triangleCount = this->triangleCount;
+}
+
+void BrickExtractor::extract(const Settings& settings, const BrickGrid& grid, int brick, BrickMesh& mesh, Vertex* vertices, std::array<int, 3>* triangles, int vertexBase) {
+    outputMode = OUTPUT_DIRECT, this->mesh = &mesh;
+    vertexOutput = vertices, triangleOutput = triangles, this->vertexBase = vertexBase;
+    vertexCount = 0, triangleCount = 0;
+    mesh.clear();
+    run(settings, grid, brick);
+}
+
+void BrickExtractor::run(const Settings& settings, const BrickGrid& grid, int brick) {
+    this->settings = &settings, this->grid = &grid, this->brick = brick;
+    const auto& dim = settings.dim;
+    grid.bounds(brick, settings.box, lo, hi);
+    kBegin = std::max(lo[2] - 1, 0), kEnd = std::min(hi[2] + 2, dim[2]);
+    seamRefVertices.clear();
+
+    signVolume.reset(dim, lo, hi, settings.type, settings.isoValue);
+    interpolatedVertexIndex.reset(lo[1], hi[1] - lo[1] + 1, lo[2], hi[2] - lo[2] + 1);
+    gradientCache.reset(std::max(lo[1] - 1, 0), std::min(hi[1] + 2, dim[1]), kEnd - kBegin);
+    if (settings.cacheFaceDecisions) faceDecisionCache.reset(lo[1], hi[1] - lo[1] + 1, lo[2], hi[2] - lo[2] + 1);
+
+    // 沿着 x 方向逐个平面推进：第 s 步生成第 s 个平面的插值顶点，然后处理第 s - 1 层的 cube
+    signVolume.buildPlane(settings.data, lo[0]);
+    if (settings.closeBoundary) capPlane(lo[0]);
+    for (int s = lo[0]; s <= hi[0]; s++) {
+        // 第 s 个平面 x 方向的边需要第 s + 1 个平面的正负性
+        if (s < hi[0]) {
+            signVolume.buildPlane(settings.data, s + 1);
+            if (settings.closeBoundary) capPlane(s + 1);
+        }
+        if (outputMode == OUTPUT_COUNT) {
+            for (int j = lo[1]; j <= hi[1]; j++) {
+                countInterpolatedVertexRow(s, j);
+            }
+        } else {
+            prepareInterpolatedVertices(s);
+            for (int j = lo[1]; j <= hi[1]; j++) {
+                computeInterpolatedVertexRow(s, j);
+            }
+        }
+        if (s > lo[0]) processSlab(s - 1);
+    }
+    if (mesh) std::sort(mesh->seamVertices.begin(), mesh->seamVertices.end());
+}
+
+void BrickExtractor::Settings::capSignRow(int i, int j, int first, int last, uint64_t* row) const {
+    // 整行在截面上的话全部置为负，否则只有 z 方向两端的截面
+    if (onCutFace(0, i) || onCutFace(1, j)) {
+        std::fill(row, row + (last - first + 64) / 64, 0);
+        return;
+    }
+    for (int k : {first, last}) {
+        if (onCutFace(2, k)) row[(k - first) >> 6] &= ~((uint64_t)1 << ((k - first) & 63));
+    }
+}
+
+void BrickExtractor::Settings::capDataRow(int i, int j, int kBegin, int kEnd, float* row) const {
+    // 截面上的体素和 getData 一样改为负的，法线也按改过的值算，封闭面的法线大致垂直于截面
+    if (i < box.lo[0] || i > box.hi[0] || j < box.lo[1] || j > box.hi[1]) return;
+    auto cap = [&](int k) {
+        row[k - kBegin] = std::min(row[k - kBegin], -FLT_EPSILON);
+    };
+    if (onCutFace(0, i) || onCutFace(1, j)) {
+        for (int k = std::max(kBegin, box.lo[2]); k <= std::min(kEnd - 1, box.hi[2]); k++) {
+            cap(k);
+        }
+        return;
+    }
+    for (int k : {box.lo[2], box.hi[2]}) {
+        if (onCutFace(2, k) && k >= kBegin && k < kEnd) cap(k);
+    }
+}
+
+void BrickExtractor::capPlane(int i) {
+    // brick 的体素范围都在 box 里面
+    for (int j = lo[1]; j <= hi[1]; j++) {
+        settings->capSignRow(i, j, lo[2], hi[2], signVolume.row(i, j));
+    }
+}
+
+void BrickExtractor::prepareInterpolatedVertices(int i) {
+    const auto& dim = settings->dim;
+    interpolatedVertexIndex.resetSlab(i);
+    gradientCache.claim(i);
+    int words = signVolume.getWordsPerRow();
+
+    // 1. 用正负性的 bit 行找出每一行在三个方向上是否有跨过等值面的边，两个端点正负不同才需要插值
+    // rowCrossing[j - lo[1]] 的第 axis 位表示 (i, j) 行在 axis 方向上有这样的边
+    rowCrossing.resize(hi[1] - lo[1] + 1);
+    for (int j = lo[1]; j <= hi[1]; j++) {
+        uint64_t crossing[3];
+        uint64_t any[3] = {0, 0, 0};
+        for (int w = 0; w < words; w++) {
+            getCrossingWords(i, j, w, crossing);
+            for (int axis = 0; axis < 3; axis++) {
+                any[axis] |= crossing[axis];
+            }
+        }
+        rowCrossing[j - lo[1]] = (any[0] ? 1 : 0) | (any[1] ? 2 : 0) | (any[2] ? 4 : 0);
+    }
+
+    // 2. 找出需要法线的行，以及计算这些法线需要的数据行，已经缓存过的不用再算
+    // (i, j) 行的顶点需要 (i, j) 行的法线，x 方向的边还需要 (i + 1, j) 行，y 方向的边还需要 (i, j + 1) 行
+    // 差分用到的相邻行按整个体数据的边界判断，这样 brick 边界上的法线和不分 brick 时完全一样
+    normalRowsToCompute.clear();
+    valueRowsToCompute.clear();
+    auto requireValue = [&](int p, int j) {
+        if (!gradientCache.valueRowReady(p, j)) {
+            gradientCache.valueRowReady(p, j) = 1;
+            valueRowsToCompute.push_back({p, j});
+        }
+    };
+    auto requireNormal = [&](int p, int j) {
+        if (gradientCache.normalRowReady(p, j)) return;
+        gradientCache.normalRowReady(p, j) = 1;
+        normalRowsToCompute.push_back({p, j});
+        requireValue(p, j);
+        if (p > 0) requireValue(p - 1, j);
+        if (p + 1 < dim[0]) requireValue(p + 1, j);
+        if (j > 0) requireValue(p, j - 1);
+        if (j + 1 < dim[1]) requireValue(p, j + 1);
+    };
+    for (int j = lo[1]; j <= hi[1]; j++) {
+        unsigned char crossing = rowCrossing[j - lo[1]];
+        if (crossing) requireNormal(i, j);
+        if (crossing & 1) requireNormal(i + 1, j);
+        if (crossing & 2) requireNormal(i, j + 1);
+    }
+
+    // 3. 先算数据行，再算法线行
+    for (const auto& row : valueRowsToCompute) {
+        loadDataRow(row[0], row[1], gradientCache.valueRow(row[0], row[1]));
+    }
+    for (const auto& row : normalRowsToCompute) {
+        computeNormalRow(row[0], row[1]);
+    }
+}
+
+void BrickExtractor::computeInterpolatedVertexRow(int i, int j) {
+    // 只遍历跨过等值面的边，生成紧凑的插值顶点
+    if (!rowCrossing[j - lo[1]]) return;
+    const auto& spacing = settings->spacing;
+    int words = signVolume.getWordsPerRow();
+    for (int w = 0; w < words; w++) {
+        uint64_t crossing[3];
+        getCrossingWords(i, j, w, crossing);
+        for (int axis = 0; axis < 3; axis++) {
+            // x, y 方向的另一个端点在相邻的行上，z 方向的在同一行的下一个体素
+            int p1 = axis == 0 ? i + 1 : i, j1 = axis == 1 ? j + 1 : j, dk = axis == 2 ? 1 : 0;
+            // gradientCache 中的行从 kBegin 开始
+            const float *value0 = gradientCache.valueRow(i, j) - kBegin, *value1 = gradientCache.valueRow(p1, j1) - kBegin;
+            uint64_t mask = crossing[axis];
+            while (mask) {
+                int k = lo[2] + w * 64 + countTrailingZeros(mask);
+                mask &= mask - 1;
+                float c0 = value0[k], c1 = value1[k + dk];
+                float ratio = c0 / (c0 - c1);
+                std::array<float, 3> normal_interpolated;
+                for (int idx = 0; idx < 3; idx++) {
+                    float n0 = gradientCache.normalRow(i, idx, j)[k - kBegin], n1 = gradientCache.normalRow(p1, idx, j1)[k + dk - kBegin];
+                    normal_interpolated[idx] = n0 + ratio * (n1 - n0);
+                }
+                std::array<float, 3> position{i * spacing[0], j * spacing[1], k * spacing[2]};
+                position[axis] = ((axis == 0 ? i : axis == 1 ? j : k) + ratio) * spacing[axis];
+                Vertex v(
+                    position[0], position[1], position[2],
+                    normal_interpolated[0],
+                    normal_interpolated[1],
+                    normal_interpolated[2]);
+                interpolatedVertexIndex.set(axis, i, j, k, addEdgeVertex(axis, i, j, k, v));
+            }
+        }
+    }
+}
+
+void BrickExtractor::countInterpolatedVertexRow(int i, int j) {
+    int words = signVolume.getWordsPerRow();
+    // 和 addEdgeVertex 一样，基点在 brick 上边界面上的顶点可能属于相邻的 brick，只有这些顶点需要检查
+    bool upper = i == hi[0] || j == hi[1];
+    for (int w = 0; w < words; w++) {
+        uint64_t crossing[3];
+        getCrossingWords(i, j, w, crossing);
+        for (int axis = 0; axis < 3; axis++) {
+            uint64_t mask = crossing[axis];
+            while (mask) {
+                int k = lo[2] + w * 64 + countTrailingZeros(mask);
+                mask &= mask - 1;
+                if ((upper || k == hi[2]) && grid->owner(i, j, k, settings->box) != brick) continue;
+                vertexCount++;
+            }
+        }
+    }
+}
+
+void BrickExtractor::getCrossingWords(int i, int j, int w, uint64_t crossing[3]) {
+    int n = hi[2] - lo[2] + 1, words = signVolume.getWordsPerRow();
+    const uint64_t* row0 = signVolume.row(i, j);
+    // brick 上边界面上的格点只有沿着这个面的边属于 brick 中的 cube
+    crossing[0] = i < hi[0] ? row0[w] ^ signVolume.row(i + 1, j)[w] : 0;
+    crossing[1] = j < hi[1] ? row0[w] ^ signVolume.row(i, j + 1)[w] : 0;
+    // z 方向第 k 条边的两个端点是 k 和 k + 1，最后一个体素没有 z 方向的边
+    uint64_t shifted = (row0[w] >> 1) | (w + 1 < words ? row0[w + 1] << 63 : 0);
+    int edges = std::min(std::max(n - 1 - w * 64, 0), 64);
+    uint64_t valid = edges == 64 ? ~(uint64_t)0 : ((uint64_t)1 << edges) - 1;
+    crossing[2] = (row0[w] ^ shifted) & valid;
+}
+
+void BrickExtractor::loadDataRow(int i, int j, float* row) {
+    const auto& dim = settings->dim;
+    dispatchVoxelType(settings->type, settings->data, [&](auto data) {
+        simd::loadRow(data + ((size_t)i * dim[1] + j) * dim[2] + kBegin, settings->isoValue, row, kEnd - kBegin);
+    });
+    if (settings->closeBoundary) settings->capDataRow(i, j, kBegin, kEnd, row);
+}
+
+void BrickExtractor::computeNormalRow(int i, int j) {
+    const auto& dim = settings->dim;
+    const auto& spacing = settings->spacing;
+    int n = kEnd - kBegin;
+    float d = settings->reverseGradientDirection ? -1 : 1;
+    const float* center = gradientCache.valueRow(i, j);
+    float *nx = gradientCache.normalRow(i, 0, j), *ny = gradientCache.normalRow(i, 1, j), *nz = gradientCache.normalRow(i, 2, j);
+
+    // x 方向，边界上用单侧差分
+    if (i == 0) {
+        simd::differenceRow(gradientCache.valueRow(i + 1, j), center, spacing[0], d, nx, n);
+    } else if (i == dim[0] - 1) {
+        simd::differenceRow(center, gradientCache.valueRow(i - 1, j), spacing[0], d, nx, n);
+    } else {
+        simd::differenceRow(gradientCache.valueRow(i + 1, j), gradientCache.valueRow(i - 1, j), 2 * spacing[0], d, nx, n);
+    }
+
+    // y 方向
+    if (j == 0) {
+        simd::differenceRow(gradientCache.valueRow(i, j + 1), center, spacing[1], d, ny, n);
+    } else if (j == dim[1] - 1) {
+        simd::differenceRow(center, gradientCache.valueRow(i, j - 1), spacing[1], d, ny, n);
+    } else {
+        simd::differenceRow(gradientCache.valueRow(i, j + 1), gradientCache.valueRow(i, j - 1), 2 * spacing[1], d, ny, n);
+    }
+
+    // z 方向就在这一行里面，只算 brick 范围 [lo[2], hi[2]] 内的体素，两侧多出来的体素只用来做差分
+    int first = lo[2] - kBegin, last = hi[2] - kBegin;
+    if (lo[2] == 0) {
+        nz[0] = (center[1] - center[0]) / spacing[2] * d;
+        first++;
+    }
+    if (hi[2] == dim[2] - 1) {
+        nz[last] = (center[last] - center[last - 1]) / spacing[2] * d;
+        last--;
+    }
+    // 中间的体素错开两个位置相减
+    if (first <= last) {
+        simd::differenceRow(center + first + 1, center + first - 1, 2 * spacing[2], d, nz + first, last - first + 1);
+    }
+}
+
+int BrickExtractor::addEdgeVertex(int axis, int i, int j, int k, const Vertex& v) {
+    const auto& dim = settings->dim;
+    int64_t key = (((int64_t)i * dim[1] + j) * dim[2] + k) * 3 + axis;
+    int owner = grid->owner(i, j, k, settings->box);
+    if (owner != brick) {
+        // 基点在 brick 的上边界面上，属于相邻的 brick，只记录引用
+        mesh->seamRefs.push_back({owner, key});
+        seamRefVertices.push_back(v);
+        return BrickMesh::SEAM + (int)seamRefVertices.size() - 1;
+    }
+    int local = appendVertex(v);
+    // 基点在 brick 的下边界面上的顶点，可能被下边相邻的 brick 引用
+    int p[3] = {i, j, k};
+    for (int a = 0; a < 3; a++) {
+        if (a != axis && p[a] == lo[a] && lo[a] > settings->box.lo[a]) {
+            mesh->seamVertices.push_back({key, local});
+            break;
+        }
+    }
+    return local;
+}
+
+void BrickExtractor::processSlab(int i) {
+    activeCells.clear();
+    for (int j = lo[1]; j < hi[1]; j++) {
+        signVolume.compactRow(i, j, activeCells);
+    }
+    if (settings->algorithm == ALGORITHM_CLASSIC) {
+        addClassicTriangles(i);
+        return;
+    }
+    if (settings->cacheFaceDecisions) faceDecisionCache.resetSlab(i);
+
+    float cube[8];
+    queue.clear();
+    for (int c = 0; c < activeCells.size(); c++) {
+        ActiveCell& cell = activeCells[c];
+        int caseIdx = cases[cell.configurationIndex][0];
+        cell.subcase = 0;
+        if (!AmbiguityQueue::needsTest(caseIdx)) continue;
+        for (int l = 0; l < 8; l++) {
+            cube[l] =
+                getData(
+                    // 编号 1, 2, 5, 6 的话 i 需要 + 1，这些数的后两位异或为 1
+                    i + ((l ^ (l >> 1)) & 1),
+                    // 编号 2, 3, 6, 7 的话 j 需要 + 1，这些数的倒数第 2 位为 1
+                    cell.j + ((l >> 1) & 1),
+                    // 编号 4, 5, 6, 7 的话 k 需要 + 1，这些数的倒数第 3 为为 1
+                    cell.k + ((l >> 2) & 1));
+        }
+        queue.push(c, caseIdx, cases[cell.configurationIndex][1], cube);
+    }
+    queue.resolve(i, activeCells, settings->cacheFaceDecisions ? &faceDecisionCache : nullptr);
+    // 注意对于有一些为了解决内部歧义的情况（例如 6.1.2），需要在 cube 正中间插值算一个顶点，这个顶点的标号为 12
+    // 原作者是主动创建点 12，我是放在了 `addTriangle` 函数里面如果需要才创建，稍微简洁一些
+    for (const auto& cell : activeCells) {
+        if (cell.subcase == AmbiguityQueue::INVALID_SUBCASE) continue;
+        const Tiling& tiling = getTiling(cell.configurationIndex, cell.subcase);
+        if (outputMode == OUTPUT_COUNT) {
+            vertexCount += tiling.center ? 1 : 0;
+            triangleCount += tiling.triangles;
+            continue;
+        }
+        addTriangle(i, cell.j, cell.k, tiling);
+    }
+}
+
+void BrickExtractor::addClassicTriangles(int i) {
+    // 每条边的方向和基点相对 cube 的偏移 (axis, di, dj, dk)，和 getCubeVertexIndex 一致，查表代替 switch
+    static const int EDGES[12][4] = {
+        {0, 0, 0, 0}, {1, 1, 0, 0}, {0, 0, 1, 0}, {1, 0, 0, 0},
+        {0, 0, 0, 1}, {1, 1, 0, 1}, {0, 0, 1, 1}, {1, 0, 0, 1},
+        {2, 0, 0, 0}, {2, 1, 0, 0}, {2, 1, 1, 0}, {2, 0, 1, 0}};
+    for (const auto& cell : activeCells) {
+        const char* edges = casesClassic[cell.configurationIndex];
+        // 每一行最多 5 个三角形，以 -1 结尾
+        for (int t = 0; edges[t] != -1; t += 3) {
+            if (outputMode == OUTPUT_COUNT) {
+                triangleCount++;
+                continue;
+            }
+            std::array<int, 3> triangle;
+            for (int c = 0; c < 3; c++) {
+                const int* e = EDGES[(int)edges[t + c]];
+                triangle[c] = interpolatedVertexIndex.get(e[0], i + e[1], cell.j + e[2], cell.k + e[3]);
+            }
+            appendTriangle(triangle);
+        }
+    }
+}
+
+int BrickExtractor::getCubeVertexIndex(int i, int j, int k, int edgeIdx, int centerVertexIndex) {
+    switch (edgeIdx) {
+        case 0:
+            return interpolatedVertexIndex.get(0, i, j, k);
+        case 1:
+            return interpolatedVertexIndex.get(1, i + 1, j, k);
+        case 2:
+            return interpolatedVertexIndex.get(0, i, j + 1, k);
+        case 3:
+            return interpolatedVertexIndex.get(1, i, j, k);
+        case 4:
+            return interpolatedVertexIndex.get(0, i, j, k + 1);
+        case 5:
+            return interpolatedVertexIndex.get(1, i + 1, j, k + 1);
+        case 6:
+            return interpolatedVertexIndex.get(0, i, j + 1, k + 1);
+        case 7:
+            return interpolatedVertexIndex.get(1, i, j, k + 1);
+        case 8:
+            return interpolatedVertexIndex.get(2, i, j, k);
+        case 9:
+            return interpolatedVertexIndex.get(2, i + 1, j, k);
+        case 10:
+            return interpolatedVertexIndex.get(2, i + 1, j + 1, k);
+        case 11:
+            return interpolatedVertexIndex.get(2, i, j + 1, k);
+        case 12:
+            return centerVertexIndex;
+    }
+    std::cerr << "wrong edgeIdx: " << edgeIdx << std::endl;
+    assert(false);
+    return -1;
+}
+
+int BrickExtractor::addCenterVertex(int i, int j, int k) {
+    // 先把 12 条边上的顶点编号找出来，cube 的 12 条边都在第 i 和 i + 1 个平面上
+    std::array<int, 12> edgeVertexIndex;
+    int cnt = 0;
+    // 4 条 x 方向的边
+    for (int s = 0; s < 2; s++) {
+        for (int t = 0; t < 2; t++) {
+            edgeVertexIndex[cnt++] = interpolatedVertexIndex.get(0, i, j + s, k + t);
+        }
+    }
+    // 4 条 y 方向的边
+    for (int s = 0; s < 2; s++) {
+        for (int t = 0; t < 2; t++) {
+            edgeVertexIndex[cnt++] = interpolatedVertexIndex.get(1, i + s, j, k + t);
+        }
+    }
+    // 4 条 z 方向的边
+    for (int s = 0; s < 2; s++) {
+        for (int t = 0; t < 2; t++) {
+            edgeVertexIndex[cnt++] = interpolatedVertexIndex.get(2, i + s, j + t, k);
+        }
+    }
+
+    // 12 号点只属于当前 cube，一定属于这个 brick；属于相邻 brick 的边上的顶点在本地也有一份
+    Vertex center(0, 0, 0, 0, 0, 0);
+    cnt = 0;
+    for (int vid : edgeVertexIndex) {
+        if (vid != -1) {
+            center += getVertex(vid);
+            cnt++;
+        }
+    }
+
+    // 既然要插值中间 vertex，肯定不可能边上没有 vertex 的
+    if (cnt == 0) {
+        std::cout << "No neighboor to compute center vertex inside cube" << std::endl;
+        assert(false);
+    }
+    center /= cnt;
+    center.normalizeNormal();
+    return appendVertex(center);
+}
+
+void BrickExtractor::addTriangle(int i, int j, int k, const Tiling& tiling) {
+    // 12 号点只属于当前 cube，需要的话先创建出来
+    int centerVertexIndex = tiling.center ? addCenterVertex(i, j, k) : -1;
+    const char* edges = tilingTable.edges + tiling.offset;
+    for (int t = 0; t < tiling.triangles; t++, edges += 3) {
+        int a = getCubeVertexIndex(i, j, k, edges[0], centerVertexIndex);
+        int b = getCubeVertexIndex(i, j, k, edges[1], centerVertexIndex);
+        int c = getCubeVertexIndex(i, j, k, edges[2], centerVertexIndex);
+        if (a == -1 || b == -1 || c == -1) {
+            std::cout << "addTriangle should got correct edge with vertice on edge" << std::endl;
+            assert(false);
+        }
+        if (a == b || b == c || a == c) {
+            std::cout << "addTriangle should got different vertices" << std::endl;
+            assert(false);
+        }
+        appendTriangle({a, b, c});
+    }
+}
@@ -0,0 +1,324 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "ambiguity_queue.h"
+#include "face_decision_cache.h"
+#include "sign_volume.h"
+#include "slab_edge_index.h"
+#include "slab_gradient_cache.h"
+#include "vertex.h"
+#include "voxel_type.h"
+
+struct Tiling;
+
+/**
+ * \brief 体素坐标下的长方体，体素范围为 [lo, hi]（两端都包含），里面的 cube 范围为 [lo, hi)
+ */
+struct VoxelBox {
+    std::array<int, 3> lo, hi;
+    inline bool operator==(const VoxelBox& other) const {
+        return lo == other.lo && hi == other.hi;
+    }
+};
+
+/**
+ * \brief 把所有 cube 划分成边长为 brickSize 的 brick
+ *
+ * 第 b 个 brick 的 cube 范围为 [lo, hi)，用到的体素范围为 [lo, hi]，相邻的 brick 共用边界上的一层体素。
+ * 每条边上的顶点只属于一个 brick：基点（编号较小的端点）落在哪个 brick 的 cube 范围里面就属于哪个 brick，
+ * 体数据最后一层体素上的基点属于最后一个 brick。
+ * 只提取一个 VoxelBox 的时候 brick 的范围再和 box 的 cube 范围求交，基点也先限制到 box 的 cube 范围里面再找所属的 brick。
+ */
+struct BrickGrid {
+    int brickSize = 32;
+    std::array<int, 3> dim{0, 0, 0}, count{0, 0, 0};
+    void reset(std::array<int, 3> dim, int brickSize) {
+        this->dim = dim, this->brickSize = brickSize;
+        for (int a = 0; a < 3; a++) {
+            count[a] = std::max(1, (dim[a] - 1 + brickSize - 1) / brickSize);
+        }
+    }
+    inline int size() const {
+        return count[0] * count[1] * count[2];
+    }
+    inline int index(int bi, int bj, int bk) const {
+        return (bi * count[1] + bj) * count[2] + bk;
+    }
+    // 第 b 个 brick 的 cube 范围 [lo, hi)
+    void bounds(int b, std::array<int, 3>& lo, std::array<int, 3>& hi) const {
+        int coord[3] = {b / (count[1] * count[2]), b / count[2] % count[1], b % count[2]};
+        for (int a = 0; a < 3; a++) {
+            lo[a] = coord[a] * brickSize;
+            hi[a] = std::max(lo[a], std::min(lo[a] + brickSize, dim[a] - 1));
+        }
+    }
+    // 第 b 个 brick 在 box 里面的 cube 范围 [lo, hi)，没有交集的话某个方向上 lo >= hi
+    void bounds(int b, const VoxelBox& box, std::array<int, 3>& lo, std::array<int, 3>& hi) const {
+        bounds(b, lo, hi);
+        for (int a = 0; a < 3; a++) {
+            lo[a] = std::max(lo[a], box.lo[a]);
+            hi[a] = std::min(hi[a], box.hi[a]);
+        }
+    }
+    // 包含 box 中 cube 的 brick 的坐标范围 [lo, hi]（两端都包含）
+    void brickRange(const VoxelBox& box, std::array<int, 3>& lo, std::array<int, 3>& hi) const {
+        for (int a = 0; a < 3; a++) {
+            lo[a] = std::min(box.lo[a] / brickSize, count[a] - 1);
+            hi[a] = std::min(std::max(box.hi[a] - 1, box.lo[a]) / brickSize, count[a] - 1);
+        }
+    }
+    // 整个体数据对应的 box
+    inline VoxelBox fullBox() const {
+        return {{0, 0, 0}, {dim[0] - 1, dim[1] - 1, dim[2] - 1}};
+    }
+    // 只提取 box 的时候基点为 (i, j, k) 的边上的顶点属于哪个 brick，box 为 fullBox() 时就是基点所在的 brick
+    inline int owner(int i, int j, int k, const VoxelBox& box) const {
+        int p[3] = {i, j, k}, coord[3];
+        for (int a = 0; a < 3; a++) {
+            coord[a] = std::min(std::min(std::max(p[a], box.lo[a]), box.hi[a] - 1) / brickSize, count[a] - 1);
+        }
+        return index(coord[0], coord[1], coord[2]);
+    }
+};
+
+/**
+ * \brief 单个 brick 的提取结果
+ * 三角形里面存的是 vertex handle：小于 SEAM 的是 vertices 中的下标，否则是 seamRefs[handle - SEAM]，
+ * 引用的是相邻 brick 拥有的顶点，合并的时候在那个 brick 的 seamVertices 中按 edge key 查找
+ */
+struct BrickMesh {
+    static const int SEAM = 1 << 30;
+    // 这个 brick 拥有的顶点，包括 12 号点
+    std::vector<Vertex> vertices;
+    std::vector<std::array<int, 3>> triangles;
+    // 这个 brick 拥有的、可能被相邻 brick 引用的顶点（基点在 brick 的下边界面上）的 edge key 和下标，按 edge key 排序
+    std::vector<std::pair<int64_t, int>> seamVertices;
+    // 引用的相邻 brick 的顶点：所属的 brick 和 edge key
+    std::vector<std::pair<int, int64_t>> seamRefs;
+    float bmax[3], bmin[3];
+    // 保留 vector 的容量，下一次运行可以直接复用
+    void clear() {
+        vertices.clear();
+        triangles.clear();
+        seamVertices.clear();
+        seamRefs.clear();
+        bmin[0] = bmin[1] = bmin[2] = std::numeric_limits<float>::max();
+        bmax[0] = bmax[1] = bmax[2] = -std::numeric_limits<float>::max();
+    }
+    inline int appendVertex(const Vertex& v) {
+        vertices.push_back(v);
+        expandBounds(v);
+        return vertices.size() - 1;
+    }
+    inline void expandBounds(const Vertex& v) {
+        bmin[0] = std::min(bmin[0], v.x), bmax[0] = std::max(bmax[0], v.x);
+        bmin[1] = std::min(bmin[1], v.y), bmax[1] = std::max(bmax[1], v.y);
+        bmin[2] = std::min(bmin[2], v.z), bmax[2] = std::max(bmax[2], v.z);
+    }
+};
+
+/**
+ * \brief FlyingEdges、AdaptiveOctree 的进度：每做完一部分调用一次 progress(work, totalWork)，work 是这一部分的工作量，
+ * totalWork 是这一次提取的总工作量。在工作线程里面调用，可能被不同的线程同时调用
+ */
+typedef std::function<void(int64_t work, int64_t totalWork)> WorkProgressCallback;
+
+/**
+ * \brief 把 vertices、triangles 这样的输出改成 size 个元素：容量不够的时候多留 1/8 的余量，
+ * 拖动滑块时网格的大小来回小幅变化，下一次运行基本不用重新分配
+ */
+template <typename T>
+inline void resizeOutput(std::vector<T>& output, size_t size, const T& value = T()) {
+    if (size > output.capacity()) output.reserve(size + size / 8);
+    output.resize(size, value);
+}
+
+/**
+ * \brief 生成三角形的方式
+ */
+enum MarchingAlgorithm {
+    // Marching Cubes 33：有歧义的面和 cube 内部都做测试，需要的话在 cube 中心加 12 号点，结果是没有裂缝的流形
+    ALGORITHM_MC33,
+    // 经典 Marching Cubes：直接按 casesClassic 表连三角形，不做任何测试，也没有 12 号点。
+    // 有歧义的面两边的 cube 连法可能不一致而出现小孔，适合预览和不要求流形的批处理
+    ALGORITHM_CLASSIC,
+    // Flying Edges：和 ALGORITHM_CLASSIC 的结果相同，但是不分 brick，按行分几遍计数、前缀和、直接写入输出，见 FlyingEdges
+    ALGORITHM_FLYING_EDGES,
+    // Surface Nets：每个和等值面相交的 cube 一个顶点（边上插值点的平均），每条跨过等值面的边连一个四边形。
+    // 顶点数大约少一半，三角形形状更均匀，但是不保证流形，box 边界上最外面一圈 cube 之间没有三角形。和 Flying Edges 共用按行的几遍，见 FlyingEdges
+    ALGORITHM_SURFACE_NETS,
+    // 自适应分辨率：平坦的地方合并成大的八叉树叶子再做 Surface Nets，三角形少很多，不同大小的叶子之间没有裂缝，见 AdaptiveOctree
+    ALGORITHM_ADAPTIVE
+};
+
+/**
+ * \brief 单独提取一个 brick 的等值面
+ *
+ * 每个线程一个，brick 内部和整个体数据的做法一样沿 x 方向逐个平面推进：构建正负性，生成插值顶点，处理 cube。
+ * 用到的正负性、数据值、法线、顶点编号都只保存 brick 范围内最近几个平面，基本都在缓存里。
+ * brick 上边界面上的边属于相邻的 brick，这些顶点在本地也算一遍（12 号点要用），但是不输出，只记录引用。
+ */
+class BrickExtractor {
+   public:
+    // 所有 brick 共用的参数
+    struct Settings {
+        // 数据的类型为 type，见 voxel_type.h
+        const void* data;
+        VoxelType type;
+        std::array<int, 3> dim;
+        std::array<float, 3> spacing;
+        bool reverseGradientDirection;
+        float isoValue;
+        bool cacheFaceDecisions;
+        // 只提取 box 里面的 cube，box 外面的体素只用来算法线
+        VoxelBox box;
+        // 为 true 时把 box 截面（不在体数据边界上的面）上的体素当作在等值面外面，曲面在截面处封闭；为 false 时直接断开
+        bool closeBoundary;
+        MarchingAlgorithm algorithm;
+        // 坐标 c 是否在 box 的 a 方向上的截面上，体数据边界上的面不算
+        inline bool onCutFace(int a, int c) const {
+            return (c == box.lo[a] && box.lo[a] > 0) || (c == box.hi[a] && box.hi[a] < dim[a] - 1);
+        }
+        // closeBoundary 时被当作在等值面外面的体素：在 box 里面并且在某个截面上
+        inline bool isCapVoxel(int i, int j, int k) const {
+            int p[3] = {i, j, k};
+            for (int a = 0; a < 3; a++) {
+                if (p[a] < box.lo[a] || p[a] > box.hi[a]) return false;
+            }
+            return onCutFace(0, i) || onCutFace(1, j) || onCutFace(2, k);
+        }
+        // closeBoundary 时把 box 里面第 (i, j) 行体素 [first, last] 的正负性中截面上的体素置为负，第 k 个体素是第 (k - first) / 64 个字的第 (k - first) % 64 位
+        void capSignRow(int i, int j, int first, int last, uint64_t* row) const;
+        // closeBoundary 时把第 (i, j) 行体素 [kBegin, kEnd) 的数据中截面上的体素改为负的，和 getData 一致
+        void capDataRow(int i, int j, int kBegin, int kEnd, float* row) const;
+    };
+    void extract(const Settings& settings, const BrickGrid& grid, int brick, BrickMesh& mesh);
+    /**
+     * \brief 只数出 extract 输出的顶点数、三角形数：正负性和 cube 的测试照做，但是不插值顶点（不算法线），也不生成三角形
+     */
+    void count(const Settings& settings, const BrickGrid& grid, int brick, int& vertexCount, int& triangleCount);
+    /**
+     * \brief 和 extract 一样，但是顶点、三角形按顺序直接写到 vertices、triangles 里面（个数就是 count 的结果），
+     * mesh 中只有 seamVertices、seamRefs 和 bounding box。三角形中这个 brick 自己的顶点已经加上 vertexBase 换成了全局下标，
+     * 引用相邻 brick 的顶点仍然是 SEAM + r，要等相邻的 brick 也写完之后再换
+     */
+    void extract(const Settings& settings, const BrickGrid& grid, int brick, BrickMesh& mesh, Vertex* vertices, std::array<int, 3>* triangles, int vertexBase);
+
+   private:
+    const Settings* settings;
+    const BrickGrid* grid;
+    int brick;
+    BrickMesh* mesh;
+    // 三种输出方式：追加到 mesh 中（extract）、只计数（count）、直接写到 vertexOutput、triangleOutput 里面（直接写入的 extract）
+    enum OutputMode { OUTPUT_MESH, OUTPUT_COUNT, OUTPUT_DIRECT };
+    OutputMode outputMode;
+    Vertex* vertexOutput;
+    std::array<int, 3>* triangleOutput;
+    // 已经输出（或者数出）的顶点数、三角形数
+    int vertexBase, vertexCount, triangleCount;
+    // 三种输出方式共用的提取过程
+    void run(const Settings& settings, const BrickGrid& grid, int brick);
+    inline int appendVertex(const Vertex& v) {
+        if (outputMode == OUTPUT_MESH) return mesh->appendVertex(v);
+        vertexOutput[vertexCount] = v;
+        mesh->expandBounds(v);
+        return vertexCount++;
+    }
+    inline void appendTriangle(std::array<int, 3> triangle) {
+        if (outputMode == OUTPUT_MESH) {
+            mesh->triangles.push_back(triangle);
+            return;
+        }
+        for (int c = 0; c < 3; c++) {
+            if (triangle[c] < BrickMesh::SEAM) triangle[c] += vertexBase;
+        }
+        triangleOutput[triangleCount++] = triangle;
+    }
+    // brick 的 cube 范围 [lo, hi)
+    std::array<int, 3> lo, hi;
+    // gradientCache 中每一行保存的体素范围 [kBegin, kEnd)，比 brick 两侧各多一个体素用来求梯度
+    int kBegin, kEnd;
+
+    inline float getData(int i, int j, int k) {
+        float val = voxelValue(settings->type, settings->data, ((size_t)i * settings->dim[1] + j) * settings->dim[2] + k) - settings->isoValue;
+        // 如果返回 0 的话，后面计算边的插值点的时候会出问题（要么插值就是 cube 顶点，要么不插值，都是不对的，前者会造成三角形塌陷成两个点，后者会造成没有顶点用来构成三角形）
+        if (std::abs(val) < FLT_EPSILON) {
+            val = FLT_EPSILON;
+        }
+        if (settings->closeBoundary && settings->isCapVoxel(i, j, k)) {
+            val = std::min(val, -FLT_EPSILON);
+        }
+        return val;
+    }
+    // closeBoundary 时把第 i 个平面上截面体素的正负性置为负，每次 buildPlane 之后调用
+    void capPlane(int i);
+
+    // brick 范围内体素的正负性
+    SignVolume signVolume;
+    // interpolatedVertexIndex.get(0, i, j, k)
+    // 表示以 (i, j, k) 点向 x 方向的边上的插值顶点的 handle，1 和 2 分别对应 y 和 z 方向
+    // 注意对于两个点的正负性相同的边，中间是不需要插值顶点的
+    SlabEdgeIndex interpolatedVertexIndex;
+    // 数据值和法线的 slab 缓存，相邻的边共用同一个体素的法线
+    SlabGradientCache gradientCache;
+    // prepareInterpolatedVertices 中每一行是否有跨过等值面的边，以及这一个平面需要计算的数据行、法线行 (i, j)
+    std::vector<unsigned char> rowCrossing;
+    std::vector<std::array<int, 2>> valueRowsToCompute, normalRowsToCompute;
+    /**
+     * \brief 为计算第 i 个平面上的插值顶点做准备：找出跨过等值面的行，算好用到的数据行和法线行
+     */
+    void prepareInterpolatedVertices(int i);
+    /**
+     * \brief 计算第 (i, j) 行 brick 范围内所有格点 x, y, z 方向边上的插值顶点，需要先调用 prepareInterpolatedVertices(i)
+     */
+    void computeInterpolatedVertexRow(int i, int j);
+    // count 时代替上面两步：只数出第 (i, j) 行上属于这个 brick 的插值顶点
+    void countInterpolatedVertexRow(int i, int j);
+    // 第 (i, j) 行第 w 个字中 x, y, z 三个方向跨过等值面的边，只包括 brick 中的 cube 用到的边
+    void getCrossingWords(int i, int j, int w, uint64_t crossing[3]);
+    // 把第 (i, j) 行 [kBegin, kEnd) 的体素按 getData 的方式转成 float
+    void loadDataRow(int i, int j, float* row);
+    /**
+     * \brief 用 gradientCache 中的数据行按行计算第 (i, j) 行 brick 范围内体素的法线（梯度方向就是法向量方向），写回 gradientCache
+     */
+    void computeNormalRow(int i, int j);
+
+    // 引用的相邻 brick 的顶点在本地算出来的值，和 mesh->seamRefs 一一对应，只用来计算 12 号点
+    std::vector<Vertex> seamRefVertices;
+    // 添加基点为 (i, j, k) 的 axis 方向的边上的顶点，返回 handle
+    int addEdgeVertex(int axis, int i, int j, int k, const Vertex& v);
+    inline const Vertex& getVertex(int handle) const {
+        if (handle >= BrickMesh::SEAM) return seamRefVertices[handle - BrickMesh::SEAM];
+        return outputMode == OUTPUT_DIRECT ? vertexOutput[handle] : mesh->vertices[handle];
+    }
+
+    // 当前 slab 中与等值面相交的 cube，按 (j, k) 排序
+    std::vector<ActiveCell> activeCells;
+    AmbiguityQueue queue;
+    FaceDecisionCache faceDecisionCache;
+    /**
+     * \brief 处理第 i 层的 cube：先分类，需要面测试、内部测试的 cube 放进 AmbiguityQueue 批量测试，确定子类之后再统一生成三角形
+     */
+    void processSlab(int i);
+    /**
+     * \brief 在 cube 正中心生成一个 vertex，返回其编号
+     */
+    int addCenterVertex(int i, int j, int k);
+    // 给定 cube 坐标和 edge 编号，求出 vertex 编号，centerVertexIndex 是 12 号点的编号
+    int getCubeVertexIndex(int i, int j, int k, int edgeIdx, int centerVertexIndex);
+    // 根据 tilingTable 里面的需要连接的边，连接对应的三角形
+    void addTriangle(int i, int j, int k, const Tiling& tiling);
+    /**
+     * \brief ALGORITHM_CLASSIC：直接按 casesClassic 表给第 i 层所有 activeCells 连三角形，不读数据，只查表
+     */
+    void addClassicTriangles(int i);
+};
@@ -0,0 +1,102 @@
+﻿#include "brick_hierarchy.h"
+
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+
+#include "sign_volume.h"
+
+void BrickHierarchy::build(const void* data, VoxelType type, const BrickGrid& grid) {
+    const auto& dim = grid.dim;
+    this->type = type;
+    levels.assign(1, Level());
+    Level& leaves = levels[0];
+    leaves.count = grid.count;
+    int bricks = grid.size();
+    leaves.min.resize(bricks);
+    leaves.max.resize(bricks);
+    dispatchVoxelType(type, data, [&](auto typed) {
+        typedef typename std::remove_const<typename std::remove_pointer<decltype(typed)>::type>::type T;
+#pragma omp parallel for schedule(dynamic)
+        for (int b = 0; b < bricks; b++) {
+            std::array<int, 3> lo, hi;
+            grid.bounds(b, lo, hi);
+            T lower = std::numeric_limits<T>::max(), upper = std::numeric_limits<T>::lowest();
+            for (int i = lo[0]; i <= hi[0]; i++) {
+                for (int j = lo[1]; j <= hi[1]; j++) {
+                    const T* row = typed + ((size_t)i * dim[1] + j) * dim[2];
+                    // 单独用两个循环，编译器可以向量化
+                    for (int k = lo[2]; k <= hi[2]; k++) {
+                        lower = std::min(lower, row[k]);
+                    }
+                    for (int k = lo[2]; k <= hi[2]; k++) {
+                        upper = std::max(upper, row[k]);
+                    }
+                }
+            }
+            leaves.min[b] = lower, leaves.max[b] = upper;
+        }
+    });
+
+    // 逐层合并 2 * 2 * 2 个节点
+    while (levels.back().count[0] * levels.back().count[1] * levels.back().count[2] > 1) {
+        Level parent;
+        const Level& child = levels.back();
+        for (int a = 0; a < 3; a++) {
+            parent.count[a] = (child.count[a] + 1) / 2;
+        }
+        parent.min.assign(parent.count[0] * parent.count[1] * parent.count[2], std::numeric_limits<float>::max());
+        parent.max.assign(parent.min.size(), std::numeric_limits<float>::lowest());
+        for (int x = 0; x < child.count[0]; x++) {
+            for (int y = 0; y < child.count[1]; y++) {
+                for (int z = 0; z < child.count[2]; z++) {
+                    int c = child.index(x, y, z), p = parent.index(x / 2, y / 2, z / 2);
+                    parent.min[p] = std::min(parent.min[p], child.min[c]);
+                    parent.max[p] = std::max(parent.max[p], child.max[c]);
+                }
+            }
+        }
+        levels.push_back(std::move(parent));
+    }
+}
+
+void BrickHierarchy::activeBricks(float isoValue, std::vector<int>& bricks) const {
+    if (levels.empty()) return;
+    const auto& count = levels[0].count;
+    activeBricks(isoValue, {0, 0, 0}, {count[0] - 1, count[1] - 1, count[2] - 1}, {false, false, false}, {false, false, false}, bricks);
+}
+
+void BrickHierarchy::activeBricks(float isoValue, std::array<int, 3> lo, std::array<int, 3> hi, std::array<bool, 3> capLo, std::array<bool, 3> capHi, std::vector<int>& bricks) const {
+    if (levels.empty()) return;
+    visit(levels.size() - 1, 0, 0, 0, {SignVolume::threshold(type, isoValue), lo, hi, capLo, capHi}, bricks);
+    // 按八叉树遍历的顺序和 brick 编号的顺序不一样
+    std::sort(bricks.begin(), bricks.end());
+}
+
+void BrickHierarchy::visit(int level, int x, int y, int z, const Query& query, std::vector<int>& bricks) const {
+    const Level& node = levels[level];
+    int n = node.index(x, y, z);
+    // 第 level 层的节点覆盖的 brick 坐标范围 [first, last]，和查询范围不相交的节点整个跳过
+    int coord[3] = {x, y, z};
+    bool capped = false;
+    for (int a = 0; a < 3; a++) {
+        int first = coord[a] << level, last = ((coord[a] + 1) << level) - 1;
+        if (last < query.lo[a] || first > query.hi[a]) return;
+        capped |= (query.capLo[a] && first <= query.lo[a]) || (query.capHi[a] && last >= query.hi[a]);
+    }
+    // 和 SignVolume 一样，值 >= threshold 的体素为正，全为正或全为负的节点里面没有等值面；
+    // 但是包含封闭截面的节点里面截面上的体素都是负的，只要有正的体素就可能有等值面
+    if (node.max[n] < query.threshold || (node.min[n] >= query.threshold && !capped)) return;
+    if (level == 0) {
+        bricks.push_back(n);
+        return;
+    }
+    const Level& child = levels[level - 1];
+    for (int cx = 2 * x; cx < std::min(2 * x + 2, child.count[0]); cx++) {
+        for (int cy = 2 * y; cy < std::min(2 * y + 2, child.count[1]); cy++) {
+            for (int cz = 2 * z; cz < std::min(2 * z + 2, child.count[2]); cz++) {
+                visit(level - 1, cx, cy, cz, query, bricks);
+            }
+        }
+    }
+}
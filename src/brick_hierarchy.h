@@ -0,0 +1,49 @@
+﻿#pragma once
+
+#include <array>
+#include <vector>
+
+#include "brick_extractor.h"
+
+/**
+ * \brief 每个 brick 体素值范围 [min, max] 组成的 min/max 八叉树
+ *
+ * 第 0 层是每个 brick 的体素范围 [lo, hi] 中的最小、最大值，上一层的每个节点合并下一层 2 * 2 * 2 个节点，直到只剩一个节点。
+ * 对一个体数据只需要构建一次，之后每次改变等值面只需要从根节点往下找：范围不跨过等值面的节点整个跳过，
+ * 这样不包含等值面的 brick 连数据都不用读。
+ * 相邻 brick 共用的边界面上的体素在两边都算，所以边界面上跨过等值面的边两边的 brick 都会被找到，共用的顶点不会丢。
+ */
+class BrickHierarchy {
+   public:
+    // data 的类型为 type，min/max 统一存成 float，不超过 16 位的整数没有误差
+    void build(const void* data, VoxelType type, const BrickGrid& grid);
+    /**
+     * \brief 找出可能和等值面相交的 brick：体素中既有 getData 为正的也有为负的，按编号从小到大追加到 bricks 中
+     */
+    void activeBricks(float isoValue, std::vector<int>& bricks) const;
+    /**
+     * \brief 只在 brick 坐标范围 [lo, hi] 里面查找，只访问和这个范围相交的节点，查询时间和范围大小有关，和整个体数据的大小无关
+     * capLo[a] / capHi[a] 为 true 表示 a 方向上第 lo[a] / hi[a] 层 brick 里面有封闭的截面（截面上的体素被当作负的），
+     * 这些 brick 只要有为正的体素就可能和等值面相交
+     */
+    void activeBricks(float isoValue, std::array<int, 3> lo, std::array<int, 3> hi, std::array<bool, 3> capLo, std::array<bool, 3> capHi, std::vector<int>& bricks) const;
+
+   private:
+    struct Level {
+        std::array<int, 3> count;
+        std::vector<float> min, max;
+        inline int index(int x, int y, int z) const {
+            return (x * count[1] + y) * count[2] + z;
+        }
+    };
+    // levels[0] 对应 brick，最后一层只有一个节点
+    std::vector<Level> levels;
+    VoxelType type = VOXEL_UINT16;
+    // 当前查询的范围
+    struct Query {
+        float threshold;
+        std::array<int, 3> lo, hi;
+        std::array<bool, 3> capLo, capHi;
+    };
+    void visit(int level, int x, int y, int z, const Query& query, std::vector<int>& bricks) const;
+};
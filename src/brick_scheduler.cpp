@@ -0,0 +1,63 @@
+﻿#include "brick_scheduler.h"
+
+#include <algorithm>
+
+void BrickScheduler::plan(const std::vector<int64_t>& costs, int workers) {
+    workers = std::max(workers, 1);
+    bricks.clear();
+    for (int b = 0; b < costs.size(); b++) {
+        if (costs[b] > 0) bricks.push_back(b);
+    }
+    // 工作量相同的按编号排，保证每次的分配结果一样
+    std::sort(bricks.begin(), bricks.end(), [&](int a, int b) {
+        return costs[a] != costs[b] ? costs[a] > costs[b] : a < b;
+    });
+
+    // 依次分给当前总工作量最小的线程
+    load.assign(workers, 0);
+    assigned.resize(workers);
+    for (auto& queue : assigned) {
+        queue.clear();
+    }
+    for (int b : bricks) {
+        int w = std::min_element(load.begin(), load.end()) - load.begin();
+        load[w] += costs[b];
+        assigned[w].push_back(b);
+    }
+
+    order.clear();
+    // Queue 里面有原子变量不能移动，线程数变了才重新分配
+    if (queues.size() != workers) queues = std::vector<Queue>(workers);
+    for (int w = 0; w < workers; w++) {
+        queues[w].begin = order.size();
+        queues[w].range.store(assigned[w].size(), std::memory_order_relaxed);
+        order.insert(order.end(), assigned[w].begin(), assigned[w].end());
+    }
+}
+
+int BrickScheduler::pop(Queue& queue, bool fromBack) {
+    uint64_t range = queue.range.load(std::memory_order_relaxed);
+    while (true) {
+        uint32_t head = range >> 32, tail = (uint32_t)range;
+        if (head >= tail) return -1;
+        uint64_t desired = fromBack ? ((uint64_t)head << 32 | (tail - 1)) : ((uint64_t)(head + 1) << 32 | tail);
+        // 失败的话 range 会被更新成最新的值，重新判断
+        if (queue.range.compare_exchange_weak(range, desired, std::memory_order_relaxed)) {
+            return order[queue.begin + (fromBack ? tail - 1 : head)];
+        }
+    }
+}
+
+int BrickScheduler::next(int worker, bool& stolen) {
+    int workers = queues.size();
+    stolen = false;
+    int b = pop(queues[worker], false);
+    if (b != -1) return b;
+    // 自己的做完了，从后面的线程开始依次偷，队列不会再增加，所以所有队列都为空就可以结束了
+    stolen = true;
+    for (int v = 1; v < workers; v++) {
+        b = pop(queues[(worker + v) % workers], true);
+        if (b != -1) return b;
+    }
+    return -1;
+}
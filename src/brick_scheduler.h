@@ -0,0 +1,83 @@
+﻿#pragma once
+
+#include <omp.h>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/**
+ * \brief 按工作量分配 brick 的 work-stealing 调度器
+ *
+ * 先按估计的工作量从大到小把 brick 依次分给当前总工作量最小的线程（LPT），每个线程的队列也就是从大到小排好的。
+ * 每个线程从自己队列的头部取，取完之后从其他线程队列的尾部偷，所以开始时大家都做大的 brick，最后用小的 brick 填补空闲。
+ * 队列在分配之后就不会再增加，头尾两个下标打包在一个 64 位原子变量里面，取和偷都只需要一次 CAS，不需要加锁，
+ * 也不依赖 OpenMP 3.0 的 task（MSVC 只支持 OpenMP 2.0）。
+ */
+class BrickScheduler {
+   public:
+    // 每个线程的统计：处理 brick 的时间、空闲的时间（秒），处理的 brick 数以及其中偷来的个数
+    struct WorkerStats {
+        double busy = 0, idle = 0;
+        int bricks = 0, stolen = 0;
+    };
+    /**
+     * \brief 按工作量把 brick 分给 workers 个线程的队列
+     * \param costs 每个 brick 估计的工作量，为 0 的 brick 不处理
+     */
+    void plan(const std::vector<int64_t>& costs, int workers);
+    /**
+     * \brief 在并行区域中处理所有 brick，work(worker, brick) 由第 worker 个线程调用
+     * 实际的线程数比 workers 少的话，剩下的队列会被偷完
+     */
+    template <class Work>
+    void run(Work work) {
+        int workers = queues.size();
+        stats.assign(workers, WorkerStats());
+        double start = omp_get_wtime();
+#pragma omp parallel num_threads(workers)
+        {
+            int t = omp_get_thread_num();
+            WorkerStats& s = stats[t];
+            bool stolen;
+            for (int b = next(t, stolen); b != -1; b = next(t, stolen)) {
+                double begin = omp_get_wtime();
+                work(t, b);
+                s.busy += omp_get_wtime() - begin;
+                s.bricks++;
+                s.stolen += stolen;
+            }
+        }
+        wallTime = omp_get_wtime() - start;
+        for (auto& s : stats) {
+            s.idle = wallTime - s.busy;
+        }
+    }
+    inline const std::vector<WorkerStats>& getWorkerStats() const {
+        return stats;
+    }
+    // 上一次 run 的总时间（秒）
+    inline double getWallTime() const {
+        return wallTime;
+    }
+
+   private:
+    // 第 worker 个线程的队列是 order[begin, begin + 初始长度)，range 的高 32 位是头部，低 32 位是尾部（都相对 begin）
+    // 每个队列单独占一个缓存行，避免不同线程的 CAS 互相干扰
+    struct alignas(64) Queue {
+        int begin = 0;
+        std::atomic<uint64_t> range{0};
+    };
+    std::vector<int> order;
+    std::vector<Queue> queues;
+    // plan 用的临时数组，保留容量，下一次 plan 可以直接复用
+    std::vector<int> bricks;
+    std::vector<int64_t> load;
+    std::vector<std::vector<int>> assigned;
+    std::vector<WorkerStats> stats;
+    double wallTime = 0;
+    // 取出第 worker 个线程的下一个 brick，没有的话返回 -1，stolen 表示是不是从其他线程偷来的
+    int next(int worker, bool& stolen);
+    // 从队列头部（fromBack 为 true 时从尾部）取出一个 brick，队列为空返回 -1
+    int pop(Queue& queue, bool fromBack);
+};
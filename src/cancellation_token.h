@@ -0,0 +1,24 @@
+﻿#pragma once
+
+#include <atomic>
+
+/**
+ * \brief 取消正在运行的 MarchingCubes::runAlgorithm
+ * 可以在任意线程里面调用 cancel，runAlgorithm 在开始提取每个 brick 之前检查，已经开始的 brick 会做完，所以很快就能返回。
+ * 同一个 token 再次使用之前需要 reset，reset 的时候不能有正在使用它的 runAlgorithm
+ */
+class CancellationToken {
+   public:
+    inline void cancel() {
+        cancelled.store(true, std::memory_order_relaxed);
+    }
+    inline void reset() {
+        cancelled.store(false, std::memory_order_relaxed);
+    }
+    inline bool isCancelled() const {
+        return cancelled.load(std::memory_order_relaxed);
+    }
+
+   private:
+    std::atomic<bool> cancelled{false};
+};
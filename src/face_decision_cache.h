@@ -0,0 +1,57 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <vector>
+
+/**
+ * \brief 当前 brick 中当前 slab 的每个面的渐近线测试（asymptotic decider）结果
+ *
+ * 每个面都被相邻的两个 cube 共用，先测试的一边把结果的符号存下来，另一边直接读取，保证两边的结果一致。
+ * x 方向的面（i 固定）被第 i - 1 和第 i 层 cube 共用，因此和 SlabEdgeIndex 一样保存两个平面；
+ * y, z 方向的面只在一个 slab 内部共用，只保存当前 slab 的。
+ * 存的是按照 AmbiguityQueue 中统一的角点顺序计算的符号，和从哪一边测试无关，所以 brick 边界上的面由两边的 brick 各算一次结果也相同。
+ */
+class FaceDecisionCache {
+   public:
+    // 还没有测试过的面
+    static constexpr signed char UNKNOWN = 2;
+    // 开始处理一个 brick，格点范围为 [jBegin, jBegin + rows) * [kBegin, kBegin + cols)
+    void reset(int jBegin, int rows, int kBegin, int cols) {
+        this->jBegin = jBegin, this->kBegin = kBegin, this->cols = cols;
+        for (auto& plane : xFaces) {
+            plane.assign(rows * cols, UNKNOWN);
+        }
+        yFaces.assign(rows * cols, UNKNOWN);
+        zFaces.assign(rows * cols, UNKNOWN);
+    }
+    // 处理第 i 层 cube 之前调用，第 i 个平面上的 x 方向的面保留上一层的结果
+    void resetSlab(int i) {
+        std::fill(xFaces[(i + 1) & 1].begin(), xFaces[(i + 1) & 1].end(), UNKNOWN);
+        std::fill(yFaces.begin(), yFaces.end(), UNKNOWN);
+        std::fill(zFaces.begin(), zFaces.end(), UNKNOWN);
+    }
+    /**
+     * \brief 第 i 层 cube (i, j, k) 的第 face 个面（0 - 5，对应 testFace 中的 1 - 6）
+     */
+    inline signed char& decision(int i, int j, int k, int face) {
+        int index = (j - jBegin) * cols + k - kBegin;
+        switch (face) {
+            case 0:
+                return yFaces[index];
+            case 1:
+                return xFaces[(i + 1) & 1][index];
+            case 2:
+                return yFaces[index + cols];
+            case 3:
+                return xFaces[i & 1][index];
+            case 4:
+                return zFaces[index];
+            default:
+                return zFaces[index + 1];
+        }
+    }
+
+   private:
+    int jBegin = 0, kBegin = 0, cols = 0;
+    std::vector<signed char> xFaces[2], yFaces, zFaces;
+};
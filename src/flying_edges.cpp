@@ -0,0 +1,411 @@
+﻿#include "flying_edges.h"
+
+#include <omp.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "LookUpTable.h"
+#include "simd.h"
+
+namespace {
+
+// 每种 configuration 按 casesClassic 连出的三角形数
+struct ClassicTriangleCounts {
+    unsigned char count[256];
+    ClassicTriangleCounts() {
+        for (int c = 0; c < 256; c++) {
+            int t = 0;
+            while (casesClassic[c][3 * t] != -1) t++;
+            count[c] = t;
+        }
+    }
+};
+const ClassicTriangleCounts classicTriangleCounts;
+
+// 连三角形时用到的 8 条交点序列 (axis, di, dj)：cube 的 12 条边分别落在哪一行的哪个方向上
+const int STREAMS[8][3] = {
+    {0, 0, 0}, {0, 0, 1}, {1, 0, 0}, {1, 1, 0},
+    {2, 0, 0}, {2, 1, 0}, {2, 1, 1}, {2, 0, 1}};
+// cube 的第 e 条边对应的序列和 k 方向的偏移，和 BrickExtractor::addClassicTriangles 的 EDGES 一致
+const int EDGE_STREAMS[12][2] = {
+    {0, 0}, {3, 0}, {1, 0}, {2, 0},
+    {0, 1}, {3, 1}, {1, 1}, {2, 1},
+    {4, 0}, {5, 0}, {6, 0}, {7, 0}};
+// cube 的第 e 条边的方向和基点相对 cube 的偏移 (axis, di, dj, dk)，以及两个端点的编号
+const int CUBE_EDGES[12][4] = {
+    {0, 0, 0, 0}, {1, 1, 0, 0}, {0, 0, 1, 0}, {1, 0, 0, 0},
+    {0, 0, 0, 1}, {1, 1, 0, 1}, {0, 0, 1, 1}, {1, 0, 0, 1},
+    {2, 0, 0, 0}, {2, 1, 0, 0}, {2, 1, 1, 0}, {2, 0, 1, 0}};
+const int CUBE_EDGE_CORNERS[12][2] = {
+    {0, 1}, {1, 2}, {3, 2}, {0, 3},
+    {4, 5}, {5, 6}, {7, 6}, {4, 7},
+    {0, 4}, {1, 5}, {2, 6}, {3, 7}};
+// Surface Nets 的四边形：围着 axis 方向的边的 4 个 cube 在 (axis + 1) % 3、(axis + 2) % 3 两个方向上的偏移，按右手方向排列
+const int QUAD_CELLS[4][2] = {{-1, -1}, {0, -1}, {0, 0}, {-1, 0}};
+
+}  // namespace
+
+bool FlyingEdges::extract(const BrickExtractor::Settings& settings, const CancellationToken* token, const WorkProgressCallback& progress, std::vector<Vertex>& vertices, std::vector<std::array<int, 3>>& triangles, float bmin[3], float bmax[3]) {
+    this->settings = &settings;
+    this->progress = &progress;
+    lo = settings.box.lo, hi = settings.box.hi;
+    // 某个方向上 box 只有一层体素的话里面没有 cube
+    for (int a = 0; a < 3; a++) {
+        if (lo[a] >= hi[a]) return true;
+    }
+    int n = hi[2] - lo[2] + 1;
+    rowsPerPlane = hi[1] - lo[1] + 1;
+    rows = (hi[0] - lo[0] + 1) * rowsPerPlane;
+    wordsPerRow = (n + 63) / 64;
+    signs.resize((size_t)rows * wordsPerRow);
+    counts.resize(rows);
+    zEdgeMask.resize(wordsPerRow);
+    for (int w = 0; w < wordsPerRow; w++) {
+        int edges = std::min(std::max(n - 1 - w * 64, 0), 64);
+        zEdgeMask[w] = edges == 64 ? ~(uint64_t)0 : ((uint64_t)1 << edges) - 1;
+    }
+    auto cancelled = [&]() { return token && token->isCancelled(); };
+
+    // 1. 正负性和 z 方向的交点
+#pragma omp parallel for schedule(dynamic, 64)
+    for (int r = 0; r < rows; r++) {
+        if (cancelled()) continue;
+        classifyRow(r);
+        reportRow(r);
+    }
+    if (cancelled()) return false;
+
+    // 2. y、x 方向的交点、相交的 cube 和三角形，要用到相邻行的正负性，所以和第 1 遍分开
+    scratches.resize(omp_get_max_threads());
+#pragma omp parallel
+    {
+        std::vector<ActiveCell>& activeCells = scratches[omp_get_thread_num()].activeCells;
+#pragma omp for schedule(dynamic, 64)
+        for (int r = 0; r < rows; r++) {
+            if (cancelled()) continue;
+            countRow(r, activeCells);
+            reportRow(r);
+        }
+    }
+    if (cancelled()) return false;
+
+    // 3. 前缀和，一次分配好输出
+    vertexOffset.resize(rows + 1);
+    triangleOffset.resize(rows + 1);
+    vertexOffset[0] = triangleOffset[0] = 0;
+    bool surfaceNets = settings.algorithm == ALGORITHM_SURFACE_NETS;
+    for (int r = 0; r < rows; r++) {
+        const RowCount& count = counts[r];
+        vertexOffset[r + 1] = vertexOffset[r] + (surfaceNets ? count.cells : count.edges[0] + count.edges[1] + count.edges[2]);
+        triangleOffset[r + 1] = triangleOffset[r] + count.triangles;
+    }
+    size_t vertexBase = vertices.size(), triangleBase = triangles.size();
+    resizeOutput(vertices, vertexBase + vertexOffset[rows], Vertex(0, 0, 0, 0, 0, 1));
+    resizeOutput(triangles, triangleBase + triangleOffset[rows]);
+    // 三角形里面的下标是相对这一次输出的，最后统一加上 vertexBase
+    dispatchVoxelType(settings.type, settings.data, [&](auto data) {
+        generate(data, token, vertices.data() + vertexBase, triangles.data() + triangleBase, bmin, bmax);
+    });
+    if (cancelled()) return false;
+    if (vertexBase > 0) {
+        int base = (int)vertexBase, count = triangleOffset[rows];
+        std::array<int, 3>* output = triangles.data() + triangleBase;
+#pragma omp parallel for
+        for (int t = 0; t < count; t++) {
+            output[t][0] += base, output[t][1] += base, output[t][2] += base;
+        }
+    }
+    return true;
+}
+
+void FlyingEdges::reportRow(int r) const {
+    // 每组 PROGRESS_ROWS 行只有最后一行报告，和哪个线程做了哪些行无关，每一遍加起来正好是 rows
+    if (*progress && ((r + 1) % PROGRESS_ROWS == 0 || r + 1 == rows)) (*progress)(r % PROGRESS_ROWS + 1, 3 * (int64_t)rows);
+}
+
+void FlyingEdges::classifyRow(int r) {
+    const auto& dim = settings->dim;
+    int i = lo[0] + r / rowsPerPlane, j = lo[1] + r % rowsPerPlane;
+    uint64_t* row = signRow(i, j);
+    SignVolume::classifyRow(settings->type, settings->data, ((size_t)i * dim[1] + j) * dim[2] + lo[2], hi[2] - lo[2] + 1,
+                            SignVolume::threshold(settings->type, settings->isoValue), row);
+    if (settings->closeBoundary) settings->capSignRow(i, j, lo[2], hi[2], row);
+    int edges = 0;
+    for (int w = 0; w < wordsPerRow; w++) {
+        edges += countBits(getCrossingWord(2, i, j, w));
+    }
+    counts[r].edges[2] = edges;
+}
+
+void FlyingEdges::countRow(int r, std::vector<ActiveCell>& activeCells) {
+    int i = lo[0] + r / rowsPerPlane, j = lo[1] + r % rowsPerPlane;
+    RowCount& count = counts[r];
+    // box 上边界面上的行只有沿着这个面的边
+    for (int axis = 0; axis < 2; axis++) {
+        int edges = 0;
+        if (axis == 0 ? i < hi[0] : j < hi[1]) {
+            for (int w = 0; w < wordsPerRow; w++) {
+                edges += countBits(getCrossingWord(axis, i, j, w));
+            }
+        }
+        count.edges[axis] = edges;
+    }
+    count.cells = count.triangles = 0;
+    if (settings->algorithm == ALGORITHM_SURFACE_NETS) {
+        for (int w = 0; w < wordsPerRow; w++) {
+            if (i < hi[0] && j < hi[1]) count.cells += countBits(getActiveCellWord(i, j, w));
+            for (int axis = 0; axis < 3; axis++) {
+                count.triangles += 2 * countBits(getQuadWord(axis, i, j, w));
+            }
+        }
+        return;
+    }
+    if (i == hi[0] || j == hi[1]) return;
+    const uint64_t* cellRows[4] = {signRow(i, j), signRow(i + 1, j), signRow(i + 1, j + 1), signRow(i, j + 1)};
+    activeCells.clear();
+    SignVolume::compactRow(cellRows, hi[2] - lo[2], j, lo[2], activeCells);
+    for (const auto& cell : activeCells) {
+        count.triangles += classicTriangleCounts.count[cell.configurationIndex];
+    }
+}
+
+template <typename T>
+void FlyingEdges::generate(const T* data, const CancellationToken* token, Vertex* vertices, std::array<int, 3>* triangles, float bmin[3], float bmax[3]) {
+#pragma omp parallel
+    {
+        RowScratch& scratch = scratches[omp_get_thread_num()];
+        scratch.kBegin = std::max(lo[2] - 1, 0), scratch.n = std::min(hi[2] + 2, settings->dim[2]) - scratch.kBegin;
+        scratch.values.resize(16 * scratch.n);
+        scratch.normals.resize(12 * scratch.n);
+        scratch.streamWords.resize(8 * wordsPerRow);
+        scratch.streamRanks.resize(8 * wordsPerRow);
+        for (int a = 0; a < 3; a++) {
+            scratch.bmin[a] = std::numeric_limits<float>::max();
+            scratch.bmax[a] = -std::numeric_limits<float>::max();
+        }
+#pragma omp for schedule(dynamic, 16)
+        for (int r = 0; r < rows; r++) {
+            if (token && token->isCancelled()) continue;
+            scratch.i = lo[0] + r / rowsPerPlane, scratch.j = lo[1] + r % rowsPerPlane;
+            std::fill(scratch.valueLoaded, scratch.valueLoaded + 16, false);
+            std::fill(scratch.normalComputed, scratch.normalComputed + 4, false);
+            if (settings->algorithm == ALGORITHM_SURFACE_NETS) {
+                generateSurfaceNetsRow(data, scratch, r, vertices, triangles);
+            } else {
+                generateRow(data, scratch, r, vertices, triangles);
+            }
+            reportRow(r);
+        }
+#pragma omp critical
+        {
+            for (int a = 0; a < 3; a++) {
+                bmin[a] = std::min(bmin[a], scratch.bmin[a]);
+                bmax[a] = std::max(bmax[a], scratch.bmax[a]);
+            }
+        }
+    }
+}
+
+template <typename T>
+void FlyingEdges::generateRow(const T* data, RowScratch& scratch, int r, Vertex* vertices, std::array<int, 3>* triangles) {
+    const auto& spacing = settings->spacing;
+    int i = scratch.i, j = scratch.j, n = scratch.n;
+    // 顶点依次是 z、y、x 方向，插值的方法和 BrickExtractor::computeInterpolatedVertexRow 一样
+    Vertex* out = vertices + vertexOffset[r];
+    for (int axis : {2, 1, 0}) {
+        if (counts[r].edges[axis] == 0) continue;
+        int di = axis == 0 ? 1 : 0, dj = axis == 1 ? 1 : 0, dk = axis == 2 ? 1 : 0;
+        const float *value0 = getValueRow(data, scratch, 0, 0) - scratch.kBegin, *value1 = getValueRow(data, scratch, di, dj) - scratch.kBegin;
+        const float *normal0 = getNormalRow(data, scratch, 0, 0) - scratch.kBegin, *normal1 = getNormalRow(data, scratch, di, dj) - scratch.kBegin;
+        for (int w = 0; w < wordsPerRow; w++) {
+            uint64_t mask = getCrossingWord(axis, i, j, w);
+            while (mask) {
+                int k = lo[2] + w * 64 + countTrailingZeros(mask);
+                mask &= mask - 1;
+                float c0 = value0[k], c1 = value1[k + dk];
+                float ratio = c0 / (c0 - c1);
+                float normal[3];
+                for (int a = 0; a < 3; a++) {
+                    float n0 = normal0[a * n + k], n1 = normal1[a * n + k + dk];
+                    normal[a] = n0 + ratio * (n1 - n0);
+                }
+                float position[3] = {i * spacing[0], j * spacing[1], k * spacing[2]};
+                position[axis] = ((axis == 0 ? i : axis == 1 ? j : k) + ratio) * spacing[axis];
+                *out++ = Vertex(position[0], position[1], position[2], normal[0], normal[1], normal[2]);
+                for (int a = 0; a < 3; a++) {
+                    scratch.bmin[a] = std::min(scratch.bmin[a], position[a]);
+                    scratch.bmax[a] = std::max(scratch.bmax[a], position[a]);
+                }
+            }
+        }
+    }
+
+    // 三角形：边上顶点的下标 = 所在行这个方向的第一个顶点 + 同一序列中排在前面的交点数
+    if (counts[r].triangles == 0) return;
+    for (int s = 0; s < 8; s++) {
+        int axis = STREAMS[s][0], i1 = i + STREAMS[s][1], j1 = j + STREAMS[s][2], r1 = rowIndex(i1, j1);
+        buildStream(scratch, s, vertexOffset[r1] + axisOffset(r1, axis), [&](int w) { return getCrossingWord(axis, i1, j1, w); });
+    }
+    const uint64_t* cellRows[4] = {signRow(i, j), signRow(i + 1, j), signRow(i + 1, j + 1), signRow(i, j + 1)};
+    scratch.activeCells.clear();
+    SignVolume::compactRow(cellRows, hi[2] - lo[2], j, lo[2], scratch.activeCells);
+    std::array<int, 3>* triangle = triangles + triangleOffset[r];
+    for (const auto& cell : scratch.activeCells) {
+        const char* edges = casesClassic[cell.configurationIndex];
+        for (int t = 0; edges[t] != -1; t += 3) {
+            for (int c = 0; c < 3; c++) {
+                const int* e = EDGE_STREAMS[(int)edges[t + c]];
+                (*triangle)[c] = getStreamVertex(scratch, e[0], cell.k + e[1]);
+            }
+            triangle++;
+        }
+    }
+}
+
+template <typename T>
+void FlyingEdges::generateSurfaceNetsRow(const T* data, RowScratch& scratch, int r, Vertex* vertices, std::array<int, 3>* triangles) {
+    const auto& spacing = settings->spacing;
+    int i = scratch.i, j = scratch.j, n = scratch.n;
+    // 顶点：以这一行为 0 号点的每个相交的 cube 一个，取 cube 的边上所有插值点的平均，插值的方法和 Flying Edges 一样
+    if (counts[r].cells > 0) {
+        const uint64_t* cellRows[4] = {signRow(i, j), signRow(i + 1, j), signRow(i + 1, j + 1), signRow(i, j + 1)};
+        scratch.activeCells.clear();
+        SignVolume::compactRow(cellRows, hi[2] - lo[2], j, lo[2], scratch.activeCells);
+        // cube 的 4 条 z 方向的棱所在的 (i + di, j + dj) 行，di, dj 为 0 或 1，第 dj * 2 + di 个
+        const float *values[4], *normals[4];
+        for (int c = 0; c < 4; c++) {
+            values[c] = getValueRow(data, scratch, c & 1, c >> 1) - scratch.kBegin;
+            normals[c] = getNormalRow(data, scratch, c & 1, c >> 1) - scratch.kBegin;
+        }
+        Vertex* out = vertices + vertexOffset[r];
+        for (const auto& cell : scratch.activeCells) {
+            float position[3] = {0, 0, 0}, normal[3] = {0, 0, 0};
+            int crossings = 0, c = cell.configurationIndex;
+            for (int e = 0; e < 12; e++) {
+                if (!(((c >> CUBE_EDGE_CORNERS[e][0]) ^ (c >> CUBE_EDGE_CORNERS[e][1])) & 1)) continue;
+                const int* edge = CUBE_EDGES[e];
+                int axis = edge[0], k = cell.k + edge[3], dk = axis == 2 ? 1 : 0;
+                int row0 = edge[2] * 2 + edge[1], row1 = row0 + (axis == 0 ? 1 : axis == 1 ? 2 : 0);
+                float c0 = values[row0][k], c1 = values[row1][k + dk];
+                float ratio = c0 / (c0 - c1);
+                int p[3] = {i + edge[1], j + edge[2], k};
+                for (int a = 0; a < 3; a++) {
+                    float n0 = normals[row0][a * n + k], n1 = normals[row1][a * n + k + dk];
+                    normal[a] += n0 + ratio * (n1 - n0);
+                    position[a] += (p[a] + (a == axis ? ratio : 0)) * spacing[a];
+                }
+                crossings++;
+            }
+            for (int a = 0; a < 3; a++) {
+                position[a] /= crossings, normal[a] /= crossings;
+                scratch.bmin[a] = std::min(scratch.bmin[a], position[a]);
+                scratch.bmax[a] = std::max(scratch.bmax[a], position[a]);
+            }
+            *out++ = Vertex(position[0], position[1], position[2], normal[0], normal[1], normal[2]);
+        }
+    }
+
+    // 四边形：周围 4 个 cube 分别在 (i - 1, j - 1)、(i - 1, j)、(i, j - 1)、(i, j) 这 4 行，第 (di + 1) * 2 + dj + 1 条序列
+    if (counts[r].triangles == 0) return;
+    for (int di = -1; di <= 0; di++) {
+        for (int dj = -1; dj <= 0; dj++) {
+            int i1 = i + di, j1 = j + dj;
+            if (i1 < lo[0] || j1 < lo[1] || i1 >= hi[0] || j1 >= hi[1]) continue;
+            buildStream(scratch, (di + 1) * 2 + dj + 1, vertexOffset[rowIndex(i1, j1)], [&](int w) { return getActiveCellWord(i1, j1, w); });
+        }
+    }
+    const uint64_t* row = signRow(i, j);
+    std::array<int, 3>* triangle = triangles + triangleOffset[r];
+    for (int axis = 0; axis < 3; axis++) {
+        int u = (axis + 1) % 3, v = (axis + 2) % 3;
+        for (int w = 0; w < wordsPerRow; w++) {
+            uint64_t mask = getQuadWord(axis, i, j, w);
+            while (mask) {
+                int kk = w * 64 + countTrailingZeros(mask);
+                mask &= mask - 1;
+                int quad[4];
+                for (int c = 0; c < 4; c++) {
+                    int offset[3] = {0, 0, 0};
+                    offset[u] = QUAD_CELLS[c][0], offset[v] = QUAD_CELLS[c][1];
+                    quad[c] = getStreamVertex(scratch, (offset[0] + 1) * 2 + offset[1] + 1, lo[2] + kk + offset[2]);
+                }
+                // 和 casesClassic 的三角形朝向一致：基点为负的话按绕 axis 的右手方向连，否则反过来
+                if ((row[w] >> (kk & 63)) & 1) {
+                    *triangle++ = {quad[0], quad[2], quad[1]};
+                    *triangle++ = {quad[0], quad[3], quad[2]};
+                } else {
+                    *triangle++ = {quad[0], quad[1], quad[2]};
+                    *triangle++ = {quad[0], quad[2], quad[3]};
+                }
+            }
+        }
+    }
+}
+
+template <typename F>
+void FlyingEdges::buildStream(RowScratch& scratch, int s, int base, F words) const {
+    scratch.streamBase[s] = base;
+    int rank = 0;
+    for (int w = 0; w < wordsPerRow; w++) {
+        uint64_t word = words(w);
+        scratch.streamWords[s * wordsPerRow + w] = word;
+        scratch.streamRanks[s * wordsPerRow + w] = rank;
+        rank += countBits(word);
+    }
+}
+
+template <typename T>
+const float* FlyingEdges::getValueRow(const T* data, RowScratch& scratch, int di, int dj) const {
+    const auto& dim = settings->dim;
+    int slot = (di + 1) * 4 + dj + 1, i = scratch.i + di, j = scratch.j + dj;
+    float* row = scratch.values.data() + slot * scratch.n;
+    if (!scratch.valueLoaded[slot]) {
+        simd::loadRow(data + ((size_t)i * dim[1] + j) * dim[2] + scratch.kBegin, settings->isoValue, row, scratch.n);
+        if (settings->closeBoundary) settings->capDataRow(i, j, scratch.kBegin, scratch.kBegin + scratch.n, row);
+        scratch.valueLoaded[slot] = true;
+    }
+    return row;
+}
+
+template <typename T>
+void FlyingEdges::computeNormalRow(const T* data, RowScratch& scratch, int di, int dj, float* normal) const {
+    const auto& dim = settings->dim;
+    const auto& spacing = settings->spacing;
+    int i = scratch.i + di, j = scratch.j + dj, n = scratch.n;
+    float d = settings->reverseGradientDirection ? -1 : 1;
+    const float* center = getValueRow(data, scratch, di, dj);
+    float *nx = normal, *ny = normal + n, *nz = normal + 2 * n;
+
+    // x 方向，边界上用单侧差分
+    if (i == 0) {
+        simd::differenceRow(getValueRow(data, scratch, di + 1, dj), center, spacing[0], d, nx, n);
+    } else if (i == dim[0] - 1) {
+        simd::differenceRow(center, getValueRow(data, scratch, di - 1, dj), spacing[0], d, nx, n);
+    } else {
+        simd::differenceRow(getValueRow(data, scratch, di + 1, dj), getValueRow(data, scratch, di - 1, dj), 2 * spacing[0], d, nx, n);
+    }
+
+    // y 方向
+    if (j == 0) {
+        simd::differenceRow(getValueRow(data, scratch, di, dj + 1), center, spacing[1], d, ny, n);
+    } else if (j == dim[1] - 1) {
+        simd::differenceRow(center, getValueRow(data, scratch, di, dj - 1), spacing[1], d, ny, n);
+    } else {
+        simd::differenceRow(getValueRow(data, scratch, di, dj + 1), getValueRow(data, scratch, di, dj - 1), 2 * spacing[1], d, ny, n);
+    }
+
+    // z 方向只算 box 范围 [lo[2], hi[2]] 内的体素
+    int first = lo[2] - scratch.kBegin, last = hi[2] - scratch.kBegin;
+    if (lo[2] == 0) {
+        nz[0] = (center[1] - center[0]) / spacing[2] * d;
+        first++;
+    }
+    if (hi[2] == dim[2] - 1) {
+        nz[last] = (center[last] - center[last - 1]) / spacing[2] * d;
+        last--;
+    }
+    if (first <= last) {
+        simd::differenceRow(center + first + 1, center + first - 1, 2 * spacing[2], d, nz + first, last - first + 1);
+    }
+}
@@ -0,0 +1,166 @@
+﻿#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "brick_extractor.h"
+#include "cancellation_token.h"
+#include "sign_volume.h"
+#include "vertex.h"
+
+/**
+ * \brief Flying Edges 方式的提取（ALGORITHM_FLYING_EDGES、ALGORITHM_SURFACE_NETS），和按 brick 提取的 BrickExtractor 是两套独立的实现
+ *
+ * 以 z 方向的一行体素 (i, j) 为单位，分四遍，每一遍都按行并行，行和行之间没有共享的状态：
+ * 1. 计算每一行的正负性 bit 行，数出行内 z 方向跨过等值面的边；
+ * 2. 数出从这一行出发的 y、x 方向（到 (i, j + 1)、(i + 1, j) 行）跨过等值面的边，以及这一行要输出的顶点数、三角形数；
+ * 3. 对每一行的顶点数、三角形数求前缀和，一次分配好准确大小的输出；
+ * 4. 每一行把自己的顶点和三角形直接写到前缀和给出的位置。
+ * 正负性整个 box 保存一份，每个体素 1 bit。
+ *
+ * ALGORITHM_FLYING_EDGES：每一行的顶点依次是 z、y、x 方向的边，各自按 k 排序，所以一条边上顶点的下标就是所在行的偏移加上
+ * 同一行同一方向上排在它前面的交点数（popcount），不需要 SlabEdgeIndex 这样的表，也不需要合并。连法和 ALGORITHM_CLASSIC 一样用 casesClassic，
+ * 顶点、法线的算法也和 BrickExtractor 一样，所以结果和 ALGORITHM_CLASSIC 相同，只是顶点、三角形的顺序不同。
+ *
+ * ALGORITHM_SURFACE_NETS：每个和等值面相交的 cube 一个顶点，位置和法线是 cube 的边上插值点的平均；
+ * 每条跨过等值面的边在周围 4 个 cube 的顶点之间连一个四边形（两个三角形），box 边界上周围不够 4 个 cube 的边不连。
+ * 第 (i, j) 行的顶点是以这一行为 0 号点的 cube，按 k 排序，下标同样是行偏移加上排在前面的相交 cube 数。
+ */
+class FlyingEdges {
+   public:
+    /**
+     * \brief 按 settings.algorithm 提取 settings.box 里面的等值面，追加到 vertices、triangles 后面，bounding box 合并到 bmin、bmax 中
+     * \param progress 不为空的话，逐行的 3 遍每做完 PROGRESS_ROWS 行报告一次，总工作量是 3 倍的行数
+     * \return 被取消的话返回 false，这时 vertices、triangles 的内容不完整
+     */
+    bool extract(const BrickExtractor::Settings& settings, const CancellationToken* token, const WorkProgressCallback& progress, std::vector<Vertex>& vertices, std::vector<std::array<int, 3>>& triangles, float bmin[3], float bmax[3]);
+    static const int PROGRESS_ROWS = 64;
+
+   private:
+    const BrickExtractor::Settings* settings;
+    const WorkProgressCallback* progress;
+    // 第 r 行做完之后调用，第 r 行是一组 PROGRESS_ROWS 行中的最后一行的话报告这一组的进度
+    void reportRow(int r) const;
+    // box 的体素范围 [lo, hi]，第 (i, j) 行的编号为 (i - lo[0]) * rowsPerPlane + j - lo[1]
+    std::array<int, 3> lo, hi;
+    int rows, rowsPerPlane, wordsPerRow;
+    // 每一行的正负性，和 SignVolume 一样第 k 个体素是第 (k - lo[2]) / 64 个字的第 (k - lo[2]) % 64 位
+    std::vector<uint64_t> signs;
+    // 每个字里面哪些位对应 z 方向的边：一行 n 个体素只有 n - 1 条边，同样也只有 n - 1 个 cube
+    std::vector<uint64_t> zEdgeMask;
+    // 每一行 axis 方向的交点数、相交的 cube 数、三角形数
+    struct RowCount {
+        int edges[3];
+        int cells;
+        int triangles;
+    };
+    std::vector<RowCount> counts;
+    // 每一行的顶点、三角形在这一次输出中的偏移，最后一个元素是总数
+    std::vector<int> vertexOffset, triangleOffset;
+
+    inline uint64_t* signRow(int i, int j) {
+        return signs.data() + ((size_t)(i - lo[0]) * rowsPerPlane + j - lo[1]) * wordsPerRow;
+    }
+    inline const uint64_t* signRow(int i, int j) const {
+        return signs.data() + ((size_t)(i - lo[0]) * rowsPerPlane + j - lo[1]) * wordsPerRow;
+    }
+    inline int rowIndex(int i, int j) const {
+        return (i - lo[0]) * rowsPerPlane + j - lo[1];
+    }
+    // 第 (i, j) 行第 w 个字中 axis 方向跨过等值面的边，x、y 方向需要 i < hi[0]、j < hi[1]
+    inline uint64_t getCrossingWord(int axis, int i, int j, int w) const {
+        const uint64_t* row = signRow(i, j);
+        if (axis == 2) {
+            uint64_t shifted = (row[w] >> 1) | (w + 1 < wordsPerRow ? row[w + 1] << 63 : 0);
+            return (row[w] ^ shifted) & zEdgeMask[w];
+        }
+        return row[w] ^ (axis == 1 ? signRow(i, j + 1) : signRow(i + 1, j))[w];
+    }
+    // 以第 (i, j) 行为 0 号点的第 w 个字中和等值面相交（8 个顶点不全相同）的 cube，需要 i < hi[0]、j < hi[1]
+    inline uint64_t getActiveCellWord(int i, int j, int w) const {
+        const uint64_t* cellRows[4] = {signRow(i, j), signRow(i + 1, j), signRow(i + 1, j + 1), signRow(i, j + 1)};
+        uint64_t any = 0, all = ~(uint64_t)0;
+        for (int r = 0; r < 4; r++) {
+            uint64_t word = cellRows[r][w], next = (word >> 1) | (w + 1 < wordsPerRow ? cellRows[r][w + 1] << 63 : 0);
+            any |= word | next, all &= word & next;
+        }
+        return any & ~all & zEdgeMask[w];
+    }
+    // Surface Nets：第 (i, j) 行第 w 个字中 axis 方向跨过等值面、周围 4 个 cube 都在 box 里面的边，每条边连一个四边形
+    inline uint64_t getQuadWord(int axis, int i, int j, int w) const {
+        bool innerI = i > lo[0] && i < hi[0], innerJ = j > lo[1] && j < hi[1];
+        // x、y 方向的边在 k 方向上也要两边都有 cube，去掉 lo[2] 和 hi[2] 上的边
+        uint64_t innerK = zEdgeMask[w] & (w == 0 ? ~(uint64_t)1 : ~(uint64_t)0);
+        if (axis == 2) return innerI && innerJ ? getCrossingWord(2, i, j, w) : 0;
+        if (axis == 1) return innerI && j < hi[1] ? getCrossingWord(1, i, j, w) & innerK : 0;
+        return i < hi[0] && innerJ ? getCrossingWord(0, i, j, w) & innerK : 0;
+    }
+    // 第 r 行 axis 方向的第一个顶点在这一行中的位置，行内依次是 z、y、x 方向
+    inline int axisOffset(int r, int axis) const {
+        return axis == 2 ? 0 : axis == 1 ? counts[r].edges[2] : counts[r].edges[2] + counts[r].edges[1];
+    }
+    // 第 1 遍：第 r 行的正负性和 z 方向的交点数
+    void classifyRow(int r);
+    // 第 2 遍：第 r 行 y、x 方向的交点数、相交的 cube 数和三角形数
+    void countRow(int r, std::vector<ActiveCell>& activeCells);
+
+    // 第 2 遍、第 4 遍每个线程一个
+    struct RowScratch {
+        // 当前处理的行
+        int i, j;
+        // 每一行缓存的体素范围 [kBegin, kBegin + n)，比 box 两侧各多一个体素用来求梯度
+        int kBegin, n;
+        // (i + di, j + dj) 行的数据，di, dj 在 [-1, 2] 之间，是第 (di + 1) * 4 + dj + 1 行，换一行就作废
+        std::vector<float> values;
+        bool valueLoaded[16];
+        // (i + di, j + dj) 行 x, y, z 方向的法线，di, dj 为 0 或 1，是第 dj * 2 + di 组，每组 3 * n 个
+        std::vector<float> normals;
+        bool normalComputed[4];
+        std::vector<ActiveCell> activeCells;
+        // 连三角形时用到的顶点序列：每个字里面有顶点的位置、这个字之前的顶点数以及第一个顶点的下标，
+        // 第 s 条序列第 w 个字的下标为 s * wordsPerRow + w
+        std::vector<uint64_t> streamWords;
+        std::vector<int> streamRanks;
+        int streamBase[8];
+        float bmin[3], bmax[3];
+    };
+    // 保留容量，下一次运行不用重新分配
+    std::vector<RowScratch> scratches;
+    /**
+     * \brief 第 4 遍：生成所有行的顶点和三角形，按体素类型实例化
+     */
+    template <typename T>
+    void generate(const T* data, const CancellationToken* token, Vertex* vertices, std::array<int, 3>* triangles, float bmin[3], float bmax[3]);
+    // ALGORITHM_FLYING_EDGES 的第 (scratch.i, scratch.j) 行
+    template <typename T>
+    void generateRow(const T* data, RowScratch& scratch, int r, Vertex* vertices, std::array<int, 3>* triangles);
+    // ALGORITHM_SURFACE_NETS 的第 (scratch.i, scratch.j) 行
+    template <typename T>
+    void generateSurfaceNetsRow(const T* data, RowScratch& scratch, int r, Vertex* vertices, std::array<int, 3>* triangles);
+    // 第 s 条序列：words(w) 是第 w 个字里面有顶点的位置，第一个顶点的下标为 base
+    template <typename F>
+    void buildStream(RowScratch& scratch, int s, int base, F words) const;
+    // 第 s 条序列中 k 处的顶点的下标
+    inline int getStreamVertex(const RowScratch& scratch, int s, int k) const {
+        int kk = k - lo[2], w = kk >> 6;
+        uint64_t before = scratch.streamWords[s * wordsPerRow + w] & (((uint64_t)1 << (kk & 63)) - 1);
+        return scratch.streamBase[s] + scratch.streamRanks[s * wordsPerRow + w] + countBits(before);
+    }
+    // 和 BrickExtractor::loadDataRow 一样的数据行
+    template <typename T>
+    const float* getValueRow(const T* data, RowScratch& scratch, int di, int dj) const;
+    // 和 BrickExtractor::computeNormalRow 一样的法线行，没有算过的话调用 computeNormalRow
+    template <typename T>
+    inline const float* getNormalRow(const T* data, RowScratch& scratch, int di, int dj) const {
+        int slot = dj * 2 + di;
+        float* normal = scratch.normals.data() + slot * 3 * scratch.n;
+        if (!scratch.normalComputed[slot]) {
+            computeNormalRow(data, scratch, di, dj, normal);
+            scratch.normalComputed[slot] = true;
+        }
+        return normal;
+    }
+    template <typename T>
+    void computeNormalRow(const T* data, RowScratch& scratch, int di, int dj, float* normal) const;
+};
@@ -3,12 +3,25 @@
 #include <QtConcurrent>
 #include <array>
 #include <iostream>
+#include <string>
 
+#include "benchmark.h"
 #include "main_window.h"
 #include "marching_cubes.h"
 #include "mesh_view_widget.h"
+#include "raw_reader.h"
 
 int main(int argc, char *argv[]) {
+    // --benchmark：不打开窗口，在示例数据上比较各个算法的速度
+    for (int a = 1; a < argc; a++) {
+        if (std::string(argv[a]) == "--benchmark") {
+            const int Z = 507, Y = 512, X = 512;
+            RawReader rawReader("../../data/cbct_sample_z=507_y=512_x=512.raw", Z, Y, X);
+            runBenchmark(rawReader.data(), {Z, Y, X}, {0.3f, 0.3f, 0.3f}, {500, 800, 1200, 1800});
+            return 0;
+        }
+    }
+
     QApplication app(argc, argv);
 
     QSurfaceFormat format;
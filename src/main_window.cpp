@@ -29,8 +29,10 @@ MainWindow::MainWindow(bool autoTest) : autoTest(autoTest) {
     mWidget->setLayout(vBoxLayout);
     setCentralWidget(mWidget);
 
-    connect(this, &MainWindow::marchingCubesFinished,
-            this, &MainWindow::updateMeshView);
+    connect(this, &MainWindow::previewFinished,
+            this, &MainWindow::showPreview);
+    connect(this, &MainWindow::refinementFinished,
+            this, &MainWindow::showRefinement);
     connect(slider, &QSlider::sliderReleased,
             this, [=]() {
                 updateIsoValue(slider->value());
@@ -44,19 +46,48 @@ MainWindow::MainWindow(bool autoTest) : autoTest(autoTest) {
 }
 
 MainWindow::~MainWindow() {
-    delete rawReader;
+    // 后台线程还在用 mc、previewMc、pyramid，先中止并等它们结束再释放
+    previewToken.cancel();
+    refineToken.cancel();
+    previewProcess.waitForFinished();
+    refineProcess.waitForFinished();
+    readDataProcess.waitForFinished();
     delete mc;
+    delete previewMc;
+    delete pyramid;
+    delete rawReader;
 }
 
 void MainWindow::readData() {
     rawReader = new RawReader("../../data/cbct_sample_z=507_y=512_x=512.raw", Z, Y, X);
     std::array<int, 3> dim{Z, Y, X};
     std::array<float, 3> spacing{0.3f, 0.3f, 0.3f};
-    mc = new MarchingCubes(rawReader->data(), dim, spacing, true);
+    pyramid = new VolumePyramid(rawReader->data(), dim, spacing);
+    mc = new MarchingCubes(*pyramid, 0, true);
+    previewMc = new MarchingCubes(*pyramid, PREVIEW_LEVEL, true);
+}
+
+void MainWindow::showPreview(float isoValue, bool completed) {
+    previewRunning = false;
+    // 被取消了或者已经过时了，有新的等值面的话接着算
+    if (!completed || isoValue != previewIsoValue) {
+        startPreview();
+        return;
+    }
+    previewIsoValue = -1;
+    meshViewWidget->setMarchingCubes(previewMc);
+    meshViewWidget->update();
+    refineIsoValue = isoValue;
+    startRefinement();
 }
 
-// 必须在 GUI 线程里面更新 OpenGL 不然会报错，因为 context 不同了
-void MainWindow::updateMeshView() {
+void MainWindow::showRefinement(float isoValue, bool completed) {
+    refineRunning = false;
+    if (!completed || isoValue != refineIsoValue) {
+        startRefinement();
+        return;
+    }
+    refineIsoValue = -1;
     meshViewWidget->setMarchingCubes(mc);
     meshViewWidget->update();
 
@@ -73,17 +104,40 @@ void MainWindow::updateMeshView() {
 void MainWindow::updateIsoValue(float isoValue) {
     std::cout << "void MainWindow::updateIsoValue(float isoValue): " << isoValue << std::endl;
     if (currentIsoValue == isoValue) return;
-    // 正在运行中的话，不允许更新
-    if (mcProcess.isStarted() && !mcProcess.isFinished()) {
-        std::cout << "skip cause process is running" << std::endl;
-        return;
-    }
     currentIsoValue = isoValue;
     // 直接调用 updateIsoValue 的话，UI 记得更新
     if (slider->value() != currentIsoValue) {
         slider->setValue(currentIsoValue);
     }
-    mcProcess = QtConcurrent::run(this, &MainWindow::runMarchingCubes, currentIsoValue);
+    // 之前等值面的计算都不需要了，马上中止，先算预览，预览显示出来之后再算完整结果
+    cancelPreview();
+    cancelRefinement();
+    previewIsoValue = currentIsoValue;
+    startPreview();
+}
+
+void MainWindow::cancelPreview() {
+    previewIsoValue = -1;
+    previewToken.cancel();
+}
+
+void MainWindow::cancelRefinement() {
+    refineIsoValue = -1;
+    refineToken.cancel();
+}
+
+void MainWindow::startPreview() {
+    if (previewIsoValue < 0 || previewRunning) return;
+    previewRunning = true;
+    previewToken.reset();
+    previewProcess = QtConcurrent::run(this, &MainWindow::runPreview, previewIsoValue);
+}
+
+void MainWindow::startRefinement() {
+    if (refineIsoValue < 0 || refineRunning) return;
+    refineRunning = true;
+    refineToken.reset();
+    refineProcess = QtConcurrent::run(this, &MainWindow::runRefinement, refineIsoValue);
 }
 
 void MainWindow::readSettings() {
@@ -109,11 +163,32 @@ void MainWindow::closeEvent(QCloseEvent *event) {
     event->accept();
 }
 
-void MainWindow::runMarchingCubes(float isoValue) {
+void MainWindow::runPreview(float isoValue) {
     readDataProcess.waitForFinished();
 
-    mc->runAlgorithm(isoValue);
+    bool completed = previewMc->runAlgorithm(isoValue, &previewToken, [this](float progress) {
+        showProgress("Preview", progress);
+    });
+
+    emit previewFinished(isoValue, completed);
+}
+
+void MainWindow::runRefinement(float isoValue) {
+    readDataProcess.waitForFinished();
+
+    bool completed = mc->runAlgorithm(isoValue, &refineToken, [this](float progress) {
+        showProgress("Refining", progress);
+    });
     // mc->saveObj("../../data/test.obj");
 
-    emit marchingCubesFinished();
+    emit refinementFinished(isoValue, completed);
+}
+
+void MainWindow::showProgress(const QString &stage, float progress) {
+    // 回调来自 MarchingCubes 的工作线程，转到 GUI 线程再更新状态栏
+    QMetaObject::invokeMethod(
+        this, [=]() {
+            statusBar()->showMessage(stage + QString(": %1%").arg((int)(progress * 100)));
+        },
+        Qt::QueuedConnection);
 }
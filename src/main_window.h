@@ -20,23 +20,51 @@ class MainWindow : public QMainWindow {
     void closeEvent(QCloseEvent *event) override;
 
    private:
-    void runMarchingCubes(float isoValue);
+    // 在后台线程中运行，结束之后发出对应的 signal
+    void runPreview(float isoValue);
+    void runRefinement(float isoValue);
+    // 没有正在运行的话开始计算 previewIsoValue 的预览 / refineIsoValue 的完整结果，正在运行的话等它结束之后再开始
+    void startPreview();
+    void startRefinement();
     void readData();
     void readSettings();
     void writeSettings();
     MeshViewWidget *meshViewWidget = nullptr;
     QSlider *slider = nullptr;
+    // 在原始数据上运行
     MarchingCubes *mc = nullptr;
+    // 在金字塔第 PREVIEW_LEVEL 层上运行，先快速显示一个粗糙的等值面
+    MarchingCubes *previewMc = nullptr;
+    VolumePyramid *pyramid = nullptr;
     float currentIsoValue = -1;
-    QFuture<void> mcProcess, readDataProcess;
+    // 需要的预览、完整结果的等值面，-1 表示不需要（已经完成或者被取消），结束的时候和这里不一致的结果直接丢掉
+    float previewIsoValue = -1, refineIsoValue = -1;
+    // 后台是否正在计算预览、完整结果，只在 GUI 线程里面读写：开始的时候设置，收到结束的 signal 的时候清除
+    bool previewRunning = false, refineRunning = false;
+    // 用来中止正在运行的预览、完整结果，开始新的计算之前 reset
+    CancellationToken previewToken, refineToken;
+    // 后台的预览、完整结果计算，析构的时候要等它们结束
+    QFuture<void> previewProcess, refineProcess;
+    // 在状态栏显示进度，可以在任意线程里面调用
+    void showProgress(const QString &stage, float progress);
+    QFuture<void> readDataProcess;
     RawReader *rawReader;
     const int Z = 507, Y = 512, X = 512;
     const int MAX_ISO_VALUE = 4000;
+    // 1/4 分辨率，体素数只有原来的 1/64
+    const int PREVIEW_LEVEL = 2;
     bool autoTest = false;
     // https://forum.qt.io/topic/52989/solved-accessing-ui-from-qtconcurrent-run/4
    signals:
-    void marchingCubesFinished();
+    // completed 为 false 表示中途被取消了
+    void previewFinished(float isoValue, bool completed);
+    void refinementFinished(float isoValue, bool completed);
    public slots:
-    void updateMeshView();
+    // 必须在 GUI 线程里面更新 OpenGL 不然会报错，因为 context 不同了
+    void showPreview(float isoValue, bool completed);
+    void showRefinement(float isoValue, bool completed);
     void updateIsoValue(float isoValue);
+    // 取消还没有显示的预览 / 完整结果，正在运行的话马上中止，两者互不影响，取消预览的话也不会再开始对应的完整结果
+    void cancelPreview();
+    void cancelRefinement();
 };
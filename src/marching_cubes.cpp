@@ -1,66 +1,121 @@
 ﻿#include "marching_cubes.h"
 
-#include <cassert>
-#include <cstring>
+#include <algorithm>
 #include <ctime>
-#include <iostream>
+#include <limits>
 
-#include "LookUpTable.h"
-
-MarchingCubes::MarchingCubes(const unsigned short* data, std::array<int, 3> dim, std::array<float, 3> spacing, bool reverseGradientDirection) {
+MarchingCubes::MarchingCubes(const void* data, VoxelType type, std::array<int, 3> dim, std::array<float, 3> spacing, bool reverseGradientDirection) {
     this->data = data;
+    this->voxelType = type;
     this->dim = dim;
     this->spacing = spacing;
     this->reverseGradientDirection = reverseGradientDirection;
-    omp_init_lock(&vertexLock);
-    omp_init_lock(&triangleLock);
+    updateBrickGrid();
+}
+
+MarchingCubes::MarchingCubes(const VolumePyramid& pyramid, int level, bool reverseGradientDirection)
+    : MarchingCubes(pyramid.data(level), pyramid.dim(level), pyramid.spacing(level), reverseGradientDirection) {
+}
+
+void MarchingCubes::updateBrickGrid() {
+    int size = std::max(brickSize, 1);
+    if (brickGrid.size() > 0 && brickGrid.brickSize == size) return;
+    brickGrid.reset(dim, size);
+    brickHierarchy.build(data, voxelType, brickGrid);
+    // 重新划分之后之前的结果都作废了
+    brickMeshes.clear();
+    activeBricks.clear();
+    hasResult = false;
+}
+
+void MarchingCubes::queryActiveBricks(float isoValue, std::vector<int>& bricks) {
+    updateBrickGrid();
+    bricks.clear();
+    brickHierarchy.activeBricks(isoValue, bricks);
+}
+
+// 各个 runAlgorithm 都把参数整理到 scratch.surfaces 中，不构造临时的数组
+bool MarchingCubes::runAlgorithm(float isoValue, const CancellationToken* token, const ProgressCallback& progress) {
+    scratch.surfaces.clear();
+    addSurface(isoValue, brickGrid.fullBox(), false);
+    return extractSurfaces(scratch.surfaces, token, progress);
+}
+
+bool MarchingCubes::runAlgorithm(const std::vector<float>& isoValues, const CancellationToken* token, const ProgressCallback& progress) {
+    scratch.surfaces.clear();
+    for (float isoValue : isoValues) {
+        addSurface(isoValue, brickGrid.fullBox(), false);
+    }
+    return extractSurfaces(scratch.surfaces, token, progress);
+}
+
+bool MarchingCubes::runAlgorithm(float isoValue, const VoxelBox& box, bool closeBoundary, const CancellationToken* token, const ProgressCallback& progress) {
+    scratch.surfaces.clear();
+    addSurface(isoValue, box, closeBoundary);
+    return extractSurfaces(scratch.surfaces, token, progress);
+}
+
+bool MarchingCubes::runAlgorithm(float isoValue, const std::vector<VoxelBox>& boxes, bool closeBoundary, const CancellationToken* token, const ProgressCallback& progress) {
+    scratch.surfaces.clear();
+    for (const VoxelBox& box : boxes) {
+        addSurface(isoValue, box, closeBoundary);
+    }
+    return extractSurfaces(scratch.surfaces, token, progress);
 }
 
-MarchingCubes::~MarchingCubes() {
-    omp_destroy_lock(&vertexLock);
-    omp_destroy_lock(&triangleLock);
+void MarchingCubes::addSurface(float isoValue, VoxelBox box, bool closeBoundary) {
+    // 去掉超出体数据的部分，hi < lo 的话这个 box 里面没有 cube
+    for (int a = 0; a < 3; a++) {
+        box.lo[a] = std::max(box.lo[a], 0);
+        box.hi[a] = std::max(std::min(box.hi[a], dim[a] - 1), box.lo[a]);
+    }
+    scratch.surfaces.push_back({isoValue, box, closeBoundary});
 }
 
-void MarchingCubes::runAlgorithm(float isoValue) {
+void MarchingCubes::queryActiveBricks(const Surface& surface, std::vector<int>& bricks) {
+    bricks.clear();
+    const VoxelBox& box = surface.box;
+    for (int a = 0; a < 3; a++) {
+        if (box.lo[a] >= box.hi[a]) return;
+    }
+    std::array<int, 3> lo, hi;
+    std::array<bool, 3> capLo{false, false, false}, capHi{false, false, false};
+    brickGrid.brickRange(box, lo, hi);
+    if (surface.closeBoundary) {
+        for (int a = 0; a < 3; a++) {
+            capLo[a] = box.lo[a] > 0, capHi[a] = box.hi[a] < dim[a] - 1;
+        }
+    }
+    brickHierarchy.activeBricks(surface.isoValue, lo, hi, capLo, capHi, bricks);
+}
+
+bool MarchingCubes::extractSurfaces(const std::vector<Surface>& surfaces, const CancellationToken* token, const ProgressCallback& progress) {
     clock_t time = clock();
-    xDirectionInterpolatedVertexIndex.clear();
-    yDirectionInterpolatedVertexIndex.clear();
-    zDirectionInterpolatedVertexIndex.clear();
-    centerInterpolatedVertexIndex.clear();
+    updateBrickGrid();
+    // 等值面和算法（以及自适应的误差）都没有变的话上一次的结果仍然有效
+    bool toleranceUnchanged = algorithm != ALGORITHM_ADAPTIVE || adaptiveTolerance == resultAdaptiveTolerance;
+    if (hasResult && surfaces == this->surfaces && algorithm == resultAlgorithm && toleranceUnchanged) {
+        printf("Isovalues unchanged, reused the previous result.\n");
+        if (progress) progress(1);
+        return true;
+    }
+    // 中途取消的话 vertices、triangles 是空的，下一次运行不能复用
+    hasResult = false;
     vertices.clear();
     triangles.clear();
 
     bmin[0] = bmin[1] = bmin[2] = std::numeric_limits<float>::max();
     bmax[0] = bmax[1] = bmax[2] = -std::numeric_limits<float>::max();
-
-    this->isoValue = isoValue;
-    // 计算所有插值顶点
-    computeInterpolatedVertices();
-
-// 运行 marching cubes 算法，marching 并逐个处理 cube
-#pragma omp parallel for
-    for (int i = 0; i < dim[0] - 1; i++) {
-        for (int j = 0; j < dim[1] - 1; j++) {
-            for (int k = 0; k < dim[2] - 1; k++) {
-                std::vector<float> cube(8);
-                // 计算 configuration 编号
-                int configurationIndex = 0;
-                for (int l = 0; l < 8; l++) {
-                    cube[l] =
-                        getData(
-                            // 编号 1, 2, 5, 6 的话 i 需要 + 1，这些数的后两位异或为 1
-                            i + ((l ^ (l >> 1)) & 1),
-                            // 编号 2, 3, 6, 7 的话 j 需要 + 1，这些数的倒数第 2 位为 1
-                            j + ((l >> 1) & 1),
-                            // 编号 4, 5, 6, 7 的话 k 需要 + 1，这些数的倒数第 3 为为 1
-                            k + ((l >> 2) & 1));
-                    if (cube[l] > 0)
-                        configurationIndex |= 1 << l;
-                }
-                processCube(i, j, k, configurationIndex, cube);
-            }
-        }
+    bool unbricked = algorithm == ALGORITHM_FLYING_EDGES || algorithm == ALGORITHM_SURFACE_NETS || algorithm == ALGORITHM_ADAPTIVE;
+    bool completed = unbricked ? extractFlyingEdges(surfaces, token, progress) : extractBricks(surfaces, token, progress);
+    if (!completed) {
+        printf("Marching Cubes cancelled after %lf secs.\n", (float)(clock() - time) / CLOCKS_PER_SEC);
+        return false;
     }
+    this->surfaces = surfaces;
+    resultAlgorithm = algorithm;
+    resultAdaptiveTolerance = adaptiveTolerance;
+    hasResult = true;
 
     maxExtent = 0.5 * (bmax[0] - bmin[0]);
     if (maxExtent < 0.5 * (bmax[1] - bmin[1])) {
@@ -71,479 +126,215 @@ void MarchingCubes::runAlgorithm(float isoValue) {
     }
 
     printf("Marching Cubes ran in %lf secs.\n", (float)(clock() - time) / CLOCKS_PER_SEC);
+    if (progress) progress(1);
+    return true;
 }
 
-void MarchingCubes::processCube(int i, int j, int k, int configurationIndex, const std::vector<float>& cube) {
-    if (i % 100 == 0 && j == 0 && k == 0)
-        std::cout << "processCube: " << i << " " << j << " " << k << std::endl;
+BrickExtractor::Settings MarchingCubes::getSettings(const Surface& surface) const {
+    return {data, voxelType, dim, spacing, reverseGradientDirection, surface.isoValue, cacheFaceDecisions, surface.box, surface.closeBoundary, algorithm};
+}
 
-    // 注意对于有一些为了解决内部歧义的情况（例如 6.1.2），需要在 cube 正中间插值算一个顶点，这个顶点的标号为 12
-    // 原作者是主动创建点 12，我是放在了 `getCubeVertexIndex` 函数里面如果需要才创建，稍微简洁一些
-    int caseIdx = cases[configurationIndex][0];
-    int configurationIndexInCase = cases[configurationIndex][1];
-    // subconfig 由多个 face 测试的二进制表示
-    int subconfig = 0, subconfig13Value;
-    // 参考 Table 1: A reduced representation of the test table. Case 13 has 45 entries to map the results of all the possible tests to the right subcase.
-    switch (caseIdx) {
-        // 0: 不需要三角形
-        case 0:
-            break;
-        // 1: 需要 1 个三角形
-        case 1:
-            addTriangle(i, j, k, {tiling1[configurationIndexInCase], tiling1[configurationIndexInCase] + 1 * 3});
-            break;
-        // 2: 需要 2 个三角形
-        case 2:
-            addTriangle(i, j, k, {tiling2[configurationIndexInCase], tiling2[configurationIndexInCase] + 2 * 3});
-            break;
-        // 3. 需要对 1 个面进行测试，- 使用 3.1，+ 使用 3.2
-        case 3:
-            if (testFace(i, j, k, cube, test3[configurationIndexInCase]) < 0) {
-                // 3.1: 需要 2 个三角形
-                addTriangle(i, j, k, {tiling3_1[configurationIndexInCase], tiling3_1[configurationIndexInCase] + 2 * 3});
-            } else {
-                // 3.2: 需要 4 个三角形
-                addTriangle(i, j, k, {tiling3_2[configurationIndexInCase], tiling3_2[configurationIndexInCase] + 4 * 3});
-            }
-            break;
-        // 4. 需要对 1 个 interior 进行测试，- 使用 4.1，+ 使用 4.2 （论文的  table 1 写错了，应该写在 interior 的测试写在了 face 上）
-        case 4:
-            // 4 的 edgeIdx 不重要，因为其强的对称性
-            if (testInterior(i, j, k, cube, caseIdx, test4[configurationIndexInCase], 1) < 0) {
-                // 4.1: 需要 2 个三角形
-                addTriangle(i, j, k, {tiling4_1[configurationIndexInCase], tiling4_1[configurationIndexInCase] + 2 * 3});
-            } else {
-                // 4.2: 需要 6 个三角形
-                addTriangle(i, j, k, {tiling4_2[configurationIndexInCase], tiling4_2[configurationIndexInCase] + 6 * 3});
-            }
-            break;
-        // 5: 需要 3 个三角形
-        case 5:
-            addTriangle(i, j, k, {tiling5[configurationIndexInCase], tiling5[configurationIndexInCase] + 3 * 3});
-            break;
-        // 6: 需要测试 1 个面，同时测试 1 个 interior
-        case 6:
-            if (testFace(i, j, k, cube, test6[configurationIndexInCase][0]) < 0) {
-                // 6.1
-                if (testInterior(i, j, k, cube, caseIdx, test6[configurationIndexInCase][1], test6[configurationIndexInCase][2]) < 0) {
-                    // 6.1.1: 3 个三角形
-                    addTriangle(i, j, k, {tiling6_1_1[configurationIndexInCase], tiling6_1_1[configurationIndexInCase] + 3 * 3});
-                } else {
-                    // 6.1.2: 9 个三角形（论文里面错写成 7 了）
-                    addTriangle(i, j, k, {tiling6_1_2[configurationIndexInCase], tiling6_1_2[configurationIndexInCase] + 9 * 3});
-                }
-            } else {
-                // 6.2: 5 个三角形
-                addTriangle(i, j, k, {tiling6_2[configurationIndexInCase], tiling6_2[configurationIndexInCase] + 5 * 3});
-            }
-            break;
-        // 7: 需要测试 3 个面，同时测试 1 个 interior
-        case 7:
-            if (testFace(i, j, k, cube, test7[configurationIndexInCase][0]) < 0) {
-                subconfig += 1;
-            }
-            if (testFace(i, j, k, cube, test7[configurationIndexInCase][1]) < 0) {
-                subconfig += 2;
-            }
-            if (testFace(i, j, k, cube, test7[configurationIndexInCase][2]) < 0) {
-                subconfig += 4;
-            }
-            switch (subconfig) {
-                case 0:
-                    // 7.1: 3 个三角形
-                    addTriangle(i, j, k, {tiling7_1[configurationIndexInCase], tiling7_1[configurationIndexInCase] + 3 * 3});
-                    break;
-                case 1:
-                    // 7.2: 5 个三角形
-                    addTriangle(i, j, k, {tiling7_2[configurationIndexInCase][0], tiling7_2[configurationIndexInCase][0] + 5 * 3});
-                    break;
-                case 2:
-                    // 7.2: 5 个三角形
-                    addTriangle(i, j, k, {tiling7_2[configurationIndexInCase][1], tiling7_2[configurationIndexInCase][1] + 5 * 3});
-                    break;
-                case 3:
-                    // 7.3: 9 个三角形
-                    addTriangle(i, j, k, {tiling7_3[configurationIndexInCase][0], tiling7_3[configurationIndexInCase][0] + 9 * 3});
-                    break;
-                case 4:
-                    // 7.2: 5 个三角形
-                    addTriangle(i, j, k, {tiling7_2[configurationIndexInCase][2], tiling7_2[configurationIndexInCase][2] + 5 * 3});
-                    break;
-                case 5:
-                    // 7.3: 9 个三角形
-                    addTriangle(i, j, k, {tiling7_3[configurationIndexInCase][1], tiling7_3[configurationIndexInCase][1] + 9 * 3});
-                    break;
-                case 6:
-                    // 7.3: 9 个三角形
-                    // v12
-                    addTriangle(i, j, k, {tiling7_3[configurationIndexInCase][2], tiling7_3[configurationIndexInCase][2] + 9 * 3});
-                    break;
-                case 7:
-                    if (testInterior(i, j, k, cube, caseIdx, test7[configurationIndexInCase][3], test7[configurationIndexInCase][4]) > 0) {
-                        // 7.4.1: 5 个三角形（论文里面写成 9 是错了）
-                        addTriangle(i, j, k, {tiling7_4_1[configurationIndexInCase], tiling7_4_1[configurationIndexInCase] + 5 * 3});
-                    } else {
-                        // 7.4.2: 9 个三角形
-                        addTriangle(i, j, k, {tiling7_4_2[configurationIndexInCase], tiling7_4_2[configurationIndexInCase] + 9 * 3});
-                    }
-                    break;
-                default:
-                    std::cout << "case 7 subconfig should in range(0, 8)" << std::endl;
-                    assert(false);
-            }
-            break;
-        // 8: 2 个三角形
-        case 8:
-            addTriangle(i, j, k, {tiling8[configurationIndexInCase], tiling8[configurationIndexInCase] + 2 * 3});
-            break;
-        // 9: 4 个三角形
-        case 9:
-            addTriangle(i, j, k, {tiling9[configurationIndexInCase], tiling9[configurationIndexInCase] + 4 * 3});
-            break;
-        // 10: 测试 2 个面，1 个 interior
-        case 10:
-            if (testFace(i, j, k, cube, test10[configurationIndexInCase][0]) > 0) {
-                subconfig += 1;
-            }
-            if (testFace(i, j, k, cube, test10[configurationIndexInCase][1]) > 0) {
-                subconfig += 2;
-            }
-            switch (subconfig) {
-                case 0:
-                    // 10 的 edgeIdx 不重要，因为其强的对称性
-                    if (testInterior(i, j, k, cube, caseIdx, test10[configurationIndexInCase][2], 1) < 0) {
-                        // 10.1.1： 4 个三角形
-                        addTriangle(i, j, k, {tiling10_1_1[configurationIndexInCase], tiling10_1_1[configurationIndexInCase] + 4 * 3});
-                    } else {
-                        // 10.1.2： 8 个三角形
-                        addTriangle(i, j, k, {tiling10_1_2[configurationIndexInCase], tiling10_1_2[configurationIndexInCase] + 8 * 3});
-                    }
-                    break;
-                case 1:
-                    // 10.2: 8 个三角形
-                    // v12
-                    addTriangle(i, j, k, {tiling10_2[configurationIndexInCase], tiling10_2[configurationIndexInCase] + 8 * 3});
-                    break;
-                case 2:
-                    // 10.2: 8 个三角形
-                    // v12
-                    addTriangle(i, j, k, {tiling10_2_[configurationIndexInCase], tiling10_2_[configurationIndexInCase] + 8 * 3});
-                    break;
-                case 3:
-                    // 10.1.1: 4 个三角形
-                    addTriangle(i, j, k, {tiling10_1_1_[configurationIndexInCase], tiling10_1_1_[configurationIndexInCase] + 4 * 3});
-                    break;
-                default:
-                    std::cout << "case 10 subconfig should in range(0, 4)" << std::endl;
-                    assert(false);
-            }
-            break;
-        // 11: 4 个三角形
-        case 11:
-            addTriangle(i, j, k, {tiling11[configurationIndexInCase], tiling11[configurationIndexInCase] + 4 * 3});
-            break;
-        // 12: 跟 10 一样的套路
-        case 12:
-            if (testFace(i, j, k, cube, test12[configurationIndexInCase][0]) > 0) {
-                subconfig += 1;
-            }
-            if (testFace(i, j, k, cube, test12[configurationIndexInCase][1]) > 0) {
-                subconfig += 2;
-            }
-            switch (subconfig) {
-                case 0:
-                    // 12 的 alongEdge 需要
-                    if (testInterior(i, j, k, cube, caseIdx, test12[configurationIndexInCase][2], test12[configurationIndexInCase][3]) < 0) {
-                        // 12.1.1： 4 个三角形
-                        addTriangle(i, j, k, {tiling12_1_1[configurationIndexInCase], tiling12_1_1[configurationIndexInCase] + 4 * 3});
-                    } else {
-                        // 12.1.2： 8 个三角形
-                        addTriangle(i, j, k, {tiling12_1_2[configurationIndexInCase], tiling12_1_2[configurationIndexInCase] + 8 * 3});
-                    }
-                    break;
-                case 1:
-                    // 12.2: 8 个三角形
-                    // v12
-                    addTriangle(i, j, k, {tiling12_2[configurationIndexInCase], tiling12_2[configurationIndexInCase] + 8 * 3});
-                    break;
-                case 2:
-                    // 12.2: 8 个三角形
-                    // v12
-                    addTriangle(i, j, k, {tiling12_2_[configurationIndexInCase], tiling12_2_[configurationIndexInCase] + 8 * 3});
-                    break;
-                case 3:
-                    // 12.1.1: 4 个三角形
-                    addTriangle(i, j, k, {tiling12_1_1_[configurationIndexInCase], tiling12_1_1_[configurationIndexInCase] + 4 * 3});
-                    break;
-                default:
-                    std::cout << "case 12 subconfig should in range(0, 4)" << std::endl;
-                    assert(false);
-            }
-            break;
-        // 13: 最为特殊的例子，有一个专门的 subconfig13 来存储配置映射信息，需要测试 6 个面和 1 个 interior
-        case 13:
-            if (testFace(i, j, k, cube, test13[configurationIndexInCase][0]) > 0) {
-                subconfig += 1;
-            }
-            if (testFace(i, j, k, cube, test13[configurationIndexInCase][1]) > 0) {
-                subconfig += 2;
-            }
-            if (testFace(i, j, k, cube, test13[configurationIndexInCase][2]) > 0) {
-                subconfig += 4;
-            }
-            if (testFace(i, j, k, cube, test13[configurationIndexInCase][3]) > 0) {
-                subconfig += 8;
-            }
-            if (testFace(i, j, k, cube, test13[configurationIndexInCase][4]) > 0) {
-                subconfig += 16;
-            }
-            if (testFace(i, j, k, cube, test13[configurationIndexInCase][5]) > 0) {
-                subconfig += 32;
-            }
-            subconfig13Value = subconfig13[subconfig];
-            // subconfig13 中其实负数出现，表示这种情况是一定不会出现的
-            if (subconfig13Value == 0) {
-                // 13.1
-                addTriangle(i, j, k, {tiling13_1[configurationIndexInCase], tiling13_1[configurationIndexInCase] + 4 * 3});
-            } else if (subconfig13Value <= 6) {
-                // 13.2
-                addTriangle(i, j, k, {tiling13_2[configurationIndexInCase][subconfig13Value - 1], tiling13_2[configurationIndexInCase][subconfig13Value - 1] + 6 * 3});
-            } else if (subconfig13Value <= 18) {
-                // 13.3
-                addTriangle(i, j, k, {tiling13_3[configurationIndexInCase][subconfig13Value - 7], tiling13_3[configurationIndexInCase][subconfig13Value - 7] + 10 * 3});
-            } else if (subconfig13Value <= 22) {
-                // 13.4
-                addTriangle(i, j, k, {tiling13_4[configurationIndexInCase][subconfig13Value - 19], tiling13_4[configurationIndexInCase][subconfig13Value - 19] + 12 * 3});
-            } else if (subconfig13Value <= 26) {
-                // 13.5
-                // 这个的 edgeIdx 比较特殊，是从 tiling13_5_1 里面拿的
-                if (testInterior(i, j, k, cube, caseIdx, test13[configurationIndexInCase][6], tiling13_5_1[configurationIndexInCase][subconfig13Value - 23][0]) < 0) {
-                    addTriangle(i, j, k, {tiling13_5_1[configurationIndexInCase][subconfig13Value - 23], tiling13_5_1[configurationIndexInCase][subconfig13Value - 23] + 6 * 3});
-                } else {
-                    addTriangle(i, j, k, {tiling13_5_2[configurationIndexInCase][subconfig13Value - 23], tiling13_5_2[configurationIndexInCase][subconfig13Value - 23] + 10 * 3});
-                }
-            } else if (subconfig13Value <= 38) {
-                // 13.3
-                addTriangle(i, j, k, {tiling13_3_[configurationIndexInCase][subconfig13Value - 27], tiling13_3_[configurationIndexInCase][subconfig13Value - 27] + 10 * 3});
-            } else if (subconfig13Value <= 44) {
-                // 13.2
-                addTriangle(i, j, k, {tiling13_2_[configurationIndexInCase][subconfig13Value - 39], tiling13_2_[configurationIndexInCase][subconfig13Value - 39] + 6 * 3});
-            } else if (subconfig13Value == 45) {
-                // 13.1
-                addTriangle(i, j, k, {tiling13_1_[configurationIndexInCase], tiling13_1_[configurationIndexInCase] + 6 * 3});
-            } else {
-                std::cout << "case 13 subconfig should in range(0, 46)" << std::endl;
-                assert(false);
+bool MarchingCubes::extractBricks(const std::vector<Surface>& surfaces, const CancellationToken* token, const ProgressCallback& progress) {
+    // 把体数据切成 brick，每个 brick 由一个线程从头到尾独立提取：构建正负性、生成插值顶点、处理 cube 都在 brick 内部逐个平面推进，
+    // 用到的数据只有 brick 范围内的几个平面，基本都在这个线程的缓存里，线程之间也不需要同步。
+    // 相邻 brick 边界面上的顶点只由一个 brick 输出（见 BrickGrid::owner），另一个 brick 只记录引用，合并的时候再换成同一个下标
+    // 用 min/max 八叉树找出和等值面相交的 brick，只重新提取这些 brick，其他 brick 保留上一次的结果。
+    // 上一次和这一次都不和等值面相交的 brick 结果本来就是空的，所以只需要清空上一次相交的 brick。
+    // 注意插值顶点的位置和等值面有关，上一次有三角形的 brick 范围一定包含上一次的等值面，和 [旧等值面, 新等值面] 相交，所以一定要重新提取或者清空
+    int bricks = brickGrid.size(), surfaceCount = surfaces.size();
+    for (int s = 0; s < activeBricks.size(); s++) {
+        for (int b : activeBricks[s]) {
+            brickMeshes[(size_t)s * bricks + b].clear();
+        }
+    }
+    brickMeshes.resize((size_t)surfaceCount * bricks);
+    activeBricks.resize(surfaceCount);
+    // 多个等值面的时候以 brick 为单位分配：一个线程接着提取同一个 brick 的所有等值面，brick 的数据读进缓存之后被所有等值面共用
+    // brickSurfaces 是按 brick 编号排好序的 (brick, 等值面编号)
+    auto& brickSurfaces = scratch.brickSurfaces;
+    brickSurfaces.clear();
+    for (int s = 0; s < surfaceCount; s++) {
+        queryActiveBricks(surfaces[s], activeBricks[s]);
+        for (int b : activeBricks[s]) {
+            brickSurfaces.push_back({b, s});
+        }
+    }
+    std::sort(brickSurfaces.begin(), brickSurfaces.end());
+
+    // 线程之间按估计的工作量分配 brick，估计不准的部分由 work stealing 补上
+    extractors.resize(omp_get_max_threads());
+    estimateBrickCosts(surfaces, brickSurfaces);
+    scheduler.plan(brickCosts, extractors.size());
+    auto& settings = scratch.settings;
+    settings.clear();
+    for (const auto& surface : surfaces) {
+        settings.push_back(getSettings(surface));
+    }
+    // 取消之后剩下的 brick 从队列里面取出来直接跳过，这时候只有部分 brick 有结果，不用合并。
+    // 没有提取的 brick 要么是空的，要么在 activeBricks 里面，下一次运行的时候会被清空，所以不会留下过时的结果
+    int64_t totalCost = 0;
+    for (int64_t cost : brickCosts) {
+        totalCost += cost;
+    }
+    completedCost.store(0, std::memory_order_relaxed);
+    reportedPercent.store(0, std::memory_order_relaxed);
+    if (exactAllocation) {
+        if (!extractBricksExact(brickSurfaces, settings, totalCost, token, progress)) return false;
+    } else {
+        scheduler.run([&](int worker, int b) {
+            if (token && token->isCancelled()) return;
+            auto it = std::lower_bound(brickSurfaces.begin(), brickSurfaces.end(), std::make_pair(b, 0));
+            for (; it != brickSurfaces.end() && it->first == b; ++it) {
+                extractors[worker].extract(settings[it->second], brickGrid, b, brickMeshes[(size_t)it->second * bricks + b]);
             }
-            break;
-        case 14:
-            // 14: 4 个三角形
-            addTriangle(i, j, k, {tiling14[configurationIndexInCase], tiling14[configurationIndexInCase] + 4 * 3});
-            break;
-        default:
-            std::cout << "case number should in range(0, 15)" << std::endl;
-            assert(false);
+            if (progress) reportProgress(brickCosts[b], totalCost, progress);
+        });
+        if (token && token->isCancelled()) return false;
+        mergeBrickMeshes();
     }
+
+    return true;
 }
 
-void MarchingCubes::addTriangle(int i, int j, int k, std::vector<char> edges) {
-#pragma omp parallel for
-    for (int l = 0; l < edges.size(); l += 3) {
-        int a = getCubeVertexIndex(i, j, k, edges[l]);
-        int b = getCubeVertexIndex(i, j, k, edges[l + 1]);
-        int c = getCubeVertexIndex(i, j, k, edges[l + 2]);
-        if (a == -1 || b == -1 || c == -1) {
-            std::cout << "addTriangle should got correct edge with vertice on edge" << std::endl;
-            assert(false);
+bool MarchingCubes::extractBricksExact(const std::vector<std::pair<int, int>>& brickSurfaces, const std::vector<BrickExtractor::Settings>& settings, int64_t totalCost, const CancellationToken* token, const ProgressCallback& progress) {
+    int bricks = brickGrid.size(), meshes = brickMeshes.size();
+    // 不是 exactAllocation 的时候留下的 brick 缓冲区也释放掉，之后只用到 seamVertices、seamRefs
+    for (auto& mesh : brickMeshes) {
+        mesh.vertices.shrink_to_fit();
+        mesh.triangles.shrink_to_fit();
+    }
+    // 依次访问第 b 个 brick 的每个等值面 visit(s, m)，m 是 brickMeshes 中的下标；计数和写入两遍各占一半的进度
+    auto forEachSurface = [&](int b, auto visit) {
+        if (token && token->isCancelled()) return;
+        auto it = std::lower_bound(brickSurfaces.begin(), brickSurfaces.end(), std::make_pair(b, 0));
+        for (; it != brickSurfaces.end() && it->first == b; ++it) {
+            visit(it->second, it->second * bricks + b);
         }
-        if (a == b || b == c || a == c) {
-            std::cout << "addTriangle should got different vertices" << std::endl;
-            assert(false);
+        if (progress) reportProgress(brickCosts[b], 2 * totalCost, progress);
+    };
+
+    // 1. 每个 brick 数出顶点数、三角形数，前缀和就是它在最终结果中的偏移，最后一个元素是总数
+    auto &vertexOffset = scratch.vertexOffset, &triangleOffset = scratch.triangleOffset;
+    vertexOffset.assign(meshes + 1, 0);
+    triangleOffset.assign(meshes + 1, 0);
+    scheduler.run([&](int worker, int b) {
+        forEachSurface(b, [&](int s, int m) {
+            extractors[worker].count(settings[s], brickGrid, b, vertexOffset[m + 1], triangleOffset[m + 1]);
+        });
+    });
+    if (token && token->isCancelled()) return false;
+    for (int m = 0; m < meshes; m++) {
+        vertexOffset[m + 1] += vertexOffset[m];
+        triangleOffset[m + 1] += triangleOffset[m];
+    }
+
+    // 2. 一次分配好，每个 brick 直接写到自己的位置，引用相邻 brick 的顶点等所有 brick 都写完之后再换成全局下标
+    resizeOutput(vertices, vertexOffset[meshes], Vertex(0, 0, 0, 0, 0, 1));
+    resizeOutput(triangles, triangleOffset[meshes]);
+    // 第一遍把队列取空了，按同样的工作量重新分配一次
+    scheduler.plan(brickCosts, extractors.size());
+    scheduler.run([&](int worker, int b) {
+        forEachSurface(b, [&](int s, int m) {
+            extractors[worker].extract(settings[s], brickGrid, b, brickMeshes[m], vertices.data() + vertexOffset[m], triangles.data() + triangleOffset[m], vertexOffset[m]);
+        });
+    });
+    if (token && token->isCancelled()) {
+        vertices.clear();
+        triangles.clear();
+        return false;
+    }
+    scratch.seamIndex.resize(omp_get_max_threads());
+#pragma omp parallel
+    {
+        std::vector<int>& seamIndex = scratch.seamIndex[omp_get_thread_num()];
+#pragma omp for schedule(dynamic)
+        for (int m = 0; m < meshes; m++) {
+            if (brickMeshes[m].seamRefs.empty()) continue;
+            getSeamIndex(m, vertexOffset, seamIndex);
+            for (int t = triangleOffset[m]; t < triangleOffset[m + 1]; t++) {
+                for (int c = 0; c < 3; c++) {
+                    if (triangles[t][c] >= BrickMesh::SEAM) triangles[t][c] = seamIndex[triangles[t][c] - BrickMesh::SEAM];
+                }
+            }
         }
-        addTriangle({a, b, c});
     }
+    finishBrickMeshes(vertexOffset, triangleOffset);
+    return true;
 }
 
-float MarchingCubes::testFace(int i, int j, int k, const std::vector<float>& cube, int f) {
-    // 渐近线测试所用的四个参数
-    int A, B, C, D;
-    // 注意有的面需要将结果取反，这个时候 f 是负数
-    // 参考 Figure 6 第 3 个图，这个顺序 ABCD 的应该是作者自己确定的，论文里面没写，这个顺序跟测试是否带正负号相关
-    switch (f) {
-        case 1:
-        case -1:
-            A = 0, B = 4, C = 5, D = 1;
-            break;
-        case 2:
-        case -2:
-            A = 1, B = 5, C = 6, D = 2;
-            break;
-        case 3:
-        case -3:
-            A = 2, B = 6, C = 7, D = 3;
-            break;
-        case 4:
-        case -4:
-            A = 3, B = 7, C = 4, D = 0;
-            break;
-        case 5:
-        case -5:
-            A = 0, B = 3, C = 2, D = 1;
-            break;
-        case 6:
-        case -6:
-            A = 4, B = 7, C = 6, D = 5;
-            break;
-        default:
-            std::cout << "testFace got wrong face index: " << f << std::endl;
-            assert(false);
+bool MarchingCubes::extractFlyingEdges(const std::vector<Surface>& surfaces, const CancellationToken* token, const ProgressCallback& progress) {
+    // 每个等值面内部按行并行，等值面之间依次进行；进度在每个等值面里面按行或者按块报告，和按 brick 提取一样每个百分点最多一次
+    surfaceRanges.clear();
+    surfacesCost = (int64_t)surfaces.size() * SURFACE_COST;
+    completedCost.store(0, std::memory_order_relaxed);
+    reportedPercent.store(0, std::memory_order_relaxed);
+    // 只捕获 this 和 progress，std::function 不用在堆上分配
+    WorkProgressCallback workProgress;
+    if (progress) {
+        workProgress = [this, &progress](int64_t work, int64_t totalWork) {
+            reportProgress(work * SURFACE_COST / totalWork, surfacesCost, progress);
+        };
     }
+    for (int s = 0; s < surfaces.size(); s++) {
+        int vertexBegin = vertices.size(), triangleBegin = triangles.size();
+        BrickExtractor::Settings settings = getSettings(surfaces[s]);
+        bool completed = algorithm == ALGORITHM_ADAPTIVE ? adaptiveOctree.extract(settings, adaptiveTolerance, token, workProgress, vertices, triangles, bmin, bmax)
+                                                         : flyingEdges.extract(settings, token, workProgress, vertices, triangles, bmin, bmax);
+        if (!completed) {
+            // 和按 brick 提取一样，取消之后 vertices、triangles 是空的
+            vertices.clear();
+            triangles.clear();
+            return false;
+        }
+        surfaceRanges.push_back({vertexBegin, (int)vertices.size(), triangleBegin, (int)triangles.size()});
+    }
+    return true;
+}
 
-    return f * cube[A] * (cube[A] * cube[C] - cube[B] * cube[D]);
+void MarchingCubes::reportProgress(int64_t cost, int64_t totalCost, const ProgressCallback& progress) {
+    int64_t completed = completedCost.fetch_add(cost, std::memory_order_relaxed) + cost;
+    int percent = totalCost > 0 ? (int)(completed * 100 / totalCost) : 100;
+    // 只有把 reportedPercent 增大的线程才调用回调，每个百分点最多一次；100% 在合并完之后再报告
+    int reported = reportedPercent.load(std::memory_order_relaxed);
+    while (percent > reported && percent < 100) {
+        if (reportedPercent.compare_exchange_weak(reported, percent, std::memory_order_relaxed)) {
+            progress(percent / 100.f);
+            return;
+        }
+    }
 }
 
-float MarchingCubes::testInterior(int i, int j, int k, const std::vector<float>& cube, int caseIdx, int alongEdgeIdx, int edgeIdx) {
-    float t, At = 0, Bt = 0, Ct = 0, Dt = 0, a, b;
-    switch (caseIdx) {
-        // 强对称性，直接计算
-        case 4:
-        case 10:
-            a = (cube[4] - cube[0]) * (cube[6] - cube[2]) - (cube[7] - cube[3]) * (cube[5] - cube[1]);
-            b = cube[2] * (cube[4] - cube[0]) + cube[0] * (cube[6] - cube[2]) - cube[1] * (cube[7] - cube[3]) - cube[3] * (cube[5] - cube[1]);
-            t = -b / (2 * a);
-            if (t > 0 || t < 1) return -alongEdgeIdx;
-            At = cube[0] + (cube[4] - cube[0]) * t;
-            Bt = cube[3] + (cube[7] - cube[3]) * t;
-            Ct = cube[2] + (cube[6] - cube[2]) * t;
-            Dt = cube[1] + (cube[5] - cube[1]) * t;
-            break;
-        // 没有强对称性，根据 edgeIdx 计算
-        case 6:
-        case 7:
-        case 12:
-        case 13:
-            switch (edgeIdx) {
-                case 0:
-                    t = cube[0] / (cube[0] - cube[1]);
-                    At = 0;
-                    Bt = cube[3] + (cube[2] - cube[3]) * t;
-                    Ct = cube[7] + (cube[6] - cube[7]) * t;
-                    Dt = cube[4] + (cube[5] - cube[4]) * t;
-                    break;
-                case 1:
-                    t = cube[1] / (cube[1] - cube[2]);
-                    At = 0;
-                    Bt = cube[0] + (cube[3] - cube[0]) * t;
-                    Ct = cube[4] + (cube[7] - cube[4]) * t;
-                    Dt = cube[5] + (cube[6] - cube[5]) * t;
-                    break;
-                case 2:
-                    t = cube[2] / (cube[2] - cube[3]);
-                    At = 0;
-                    Bt = cube[1] + (cube[0] - cube[1]) * t;
-                    Ct = cube[5] + (cube[4] - cube[5]) * t;
-                    Dt = cube[6] + (cube[7] - cube[6]) * t;
-                    break;
-                case 3:
-                    t = cube[3] / (cube[3] - cube[0]);
-                    At = 0;
-                    Bt = cube[2] + (cube[1] - cube[2]) * t;
-                    Ct = cube[6] + (cube[5] - cube[6]) * t;
-                    Dt = cube[7] + (cube[4] - cube[7]) * t;
-                    break;
-                case 4:
-                    t = cube[4] / (cube[4] - cube[5]);
-                    At = 0;
-                    Bt = cube[7] + (cube[6] - cube[7]) * t;
-                    Ct = cube[3] + (cube[2] - cube[3]) * t;
-                    Dt = cube[0] + (cube[1] - cube[0]) * t;
-                    break;
-                case 5:
-                    t = cube[5] / (cube[5] - cube[6]);
-                    At = 0;
-                    Bt = cube[4] + (cube[7] - cube[4]) * t;
-                    Ct = cube[0] + (cube[3] - cube[0]) * t;
-                    Dt = cube[1] + (cube[2] - cube[1]) * t;
-                    break;
-                case 6:
-                    t = cube[6] / (cube[6] - cube[7]);
-                    At = 0;
-                    Bt = cube[5] + (cube[4] - cube[5]) * t;
-                    Ct = cube[1] + (cube[0] - cube[1]) * t;
-                    Dt = cube[2] + (cube[3] - cube[2]) * t;
-                    break;
-                case 7:
-                    t = cube[7] / (cube[7] - cube[4]);
-                    At = 0;
-                    Bt = cube[6] + (cube[5] - cube[6]) * t;
-                    Ct = cube[2] + (cube[1] - cube[2]) * t;
-                    Dt = cube[3] + (cube[0] - cube[3]) * t;
-                    break;
-                case 8:
-                    t = cube[0] / (cube[0] - cube[4]);
-                    At = 0;
-                    Bt = cube[3] + (cube[7] - cube[3]) * t;
-                    Ct = cube[2] + (cube[6] - cube[2]) * t;
-                    Dt = cube[1] + (cube[5] - cube[1]) * t;
-                    break;
-                case 9:
-                    t = cube[1] / (cube[1] - cube[5]);
-                    At = 0;
-                    Bt = cube[0] + (cube[4] - cube[0]) * t;
-                    Ct = cube[3] + (cube[7] - cube[3]) * t;
-                    Dt = cube[2] + (cube[6] - cube[2]) * t;
-                    break;
-                case 10:
-                    t = cube[2] / (cube[2] - cube[6]);
-                    At = 0;
-                    Bt = cube[1] + (cube[5] - cube[1]) * t;
-                    Ct = cube[0] + (cube[4] - cube[0]) * t;
-                    Dt = cube[3] + (cube[7] - cube[3]) * t;
-                    break;
-                case 11:
-                    t = cube[3] / (cube[3] - cube[7]);
-                    At = 0;
-                    Bt = cube[2] + (cube[6] - cube[2]) * t;
-                    Ct = cube[1] + (cube[5] - cube[1]) * t;
-                    Dt = cube[0] + (cube[4] - cube[0]) * t;
-                    break;
-                default:
-                    std::cout << "testInterior got wrong edgeIdx: " << edgeIdx << std::endl;
-                    assert(false);
-                    break;
+void MarchingCubes::estimateBrickCosts(const std::vector<Surface>& surfaces, const std::vector<std::pair<int, int>>& brickSurfaces) {
+    auto& thresholds = scratch.thresholds;
+    thresholds.clear();
+    for (const auto& surface : surfaces) {
+        thresholds.push_back(SignVolume::threshold(voxelType, surface.isoValue));
+    }
+    int items = brickSurfaces.size();
+    auto& costs = scratch.costs;
+    costs.resize(items);
+#pragma omp parallel for schedule(dynamic)
+    for (int item = 0; item < items; item++) {
+        int b = brickSurfaces[item].first, s = brickSurfaces[item].second;
+        float threshold = thresholds[s];
+        std::array<int, 3> lo, hi;
+        brickGrid.bounds(b, surfaces[s].box, lo, hi);
+        int64_t crossings = 0;
+        dispatchVoxelType(voxelType, data, [&](auto typed) {
+            for (int i = lo[0]; i <= hi[0]; i += COST_SAMPLE_STRIDE) {
+                for (int j = lo[1]; j <= hi[1]; j += COST_SAMPLE_STRIDE) {
+                    auto row = typed + ((size_t)i * dim[1] + j) * dim[2];
+                    for (int k = lo[2]; k < hi[2]; k++) {
+                        crossings += (row[k] >= threshold) != (row[k + 1] >= threshold);
+                    }
+                }
             }
-            break;
-        default:
-            std::cout << "testInterior got wrong caseIdx: " << caseIdx << std::endl;
-            assert(false);
+        });
+        costs[item] = 1 + crossings * COST_SAMPLE_STRIDE * COST_SAMPLE_STRIDE;
     }
-
-    int test = 0;
-    if (At >= 0) test++;
-    if (Bt >= 0) test += 2;
-    if (Ct >= 0) test += 4;
-    if (Dt >= 0) test += 8;
-    if (test <= 4)
-        return -alongEdgeIdx;
-    else if (test == 5)
-        return (At * Ct - Bt * Dt) * alongEdgeIdx;
-    else if (test == 6)
-        return -alongEdgeIdx;
-    else if (test == 7)
-        return alongEdgeIdx;
-    else if (test <= 9)
-        return -alongEdgeIdx;
-    else if (test == 10)
-        return -(At * Ct - Bt * Dt) * alongEdgeIdx;
-    else if (test == 11)
-        return alongEdgeIdx;
-    else if (test == 12)
-        return -alongEdgeIdx;
-    else if (test <= 15)
-        return alongEdgeIdx;
-    else {
-        std::cout << "testInterior got wrong test value: " << test << std::endl;
-        assert(false);
-        return -1;
+    // 同一个 brick 的所有等值面由同一个线程提取，工作量加在一起
+    brickCosts.assign(brickGrid.size(), 0);
+    for (int item = 0; item < items; item++) {
+        brickCosts[brickSurfaces[item].first] += costs[item];
     }
 }
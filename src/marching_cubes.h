@@ -4,50 +4,79 @@ Marching Cubes 算法实现
 */
 #pragma once
 
-#include <concurrent_unordered_map.h>
 #include <omp.h>
 
 #include <array>
-#include <glm/glm.hpp>
-#include <glm/gtx/hash.hpp>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <functional>
 #include <iostream>
+#include <limits>
 #include <string>
-#include <unordered_map>
 #include <vector>
-struct Vertex {
-    // 顶点坐标
-    float x, y, z;
-    // 法向量
-    float nx, ny, nz;
-    Vertex(float x, float y, float z, float nx, float ny, int nz) : x(x), y(y), z(z), nx(nx), ny(ny), nz(nz) {
-        normalizeNormal();
-    }
-    Vertex& operator+=(const Vertex& rhs) {
-        x += rhs.x, y += rhs.y, z += rhs.z;
-        nx += rhs.nx, ny += rhs.ny, nz += rhs.nz;
-        return *this;
-    }
-    Vertex& operator/=(const int n) {
-        x /= n, y /= n, z /= n;
-        nx /= n, ny /= n, nz /= n;
-        return *this;
-    }
-    void normalizeNormal() {
-        float len2 = nx * nx + ny * ny + nz * nz;
-        float len = sqrt(len2);
-        nx /= len, ny /= len, nz /= len;
-    }
-};
+
+#include "brick_extractor.h"
+#include "brick_hierarchy.h"
+#include "adaptive_octree.h"
+#include "brick_scheduler.h"
+#include "cancellation_token.h"
+#include "flying_edges.h"
+#include "volume_pyramid.h"
+#include "voxel_type.h"
 
 class MarchingCubes {
    public:
-    MarchingCubes(const unsigned short* data, std::array<int, 3> dim, std::array<float, 3> spacing, bool reverseGradientDirection = false);
-    MarchingCubes::~MarchingCubes();
+    /**
+     * \param data 体数据，T 可以是 unsigned char、short、unsigned short 或者 float（见 voxel_type.h），直接使用不复制，需要比 MarchingCubes 活得久
+     */
+    template <typename T>
+    MarchingCubes(const T* data, std::array<int, 3> dim, std::array<float, 3> spacing, bool reverseGradientDirection = false)
+        : MarchingCubes((const void*)data, VoxelTraits<T>::type, dim, spacing, reverseGradientDirection) {
+    }
+    // 在金字塔的第 level 层上运行，pyramid 需要比 MarchingCubes 活得久
+    MarchingCubes(const VolumePyramid& pyramid, int level, bool reverseGradientDirection = false);
+    /**
+     * \brief 进度回调，参数为 0 到 1 之间已经完成的比例
+     * 会在提取 brick 的工作线程里面调用，可能被不同的线程同时调用，每个百分点最多一次，进度不保证按顺序到达。
+     * 需要是线程安全的并且尽快返回，更新界面的话需要自己转到 GUI 线程
+     */
+    typedef std::function<void(float progress)> ProgressCallback;
     /**
     * 运行算法，生成顶点（带法线）、三角形
+    * 只重新提取和上一次、这一次的等值面相交的 brick，其他 brick 保留上一次的结果；等值面没有变的话直接返回
     * \param isoValue 等值面大小
+    * \param token 不为空的话，被取消之后尽快返回，此时 vertices 和 triangles 为空
+    * \param progress 不为空的话，每提取完一部分 brick 报告一次进度
+    * \return 是否完整运行（没有被取消）
+    **/
+    bool runAlgorithm(float isoValue, const CancellationToken* token = nullptr, const ProgressCallback& progress = nullptr);
+    /**
+    * 一次提取多个等值面，所有等值面的顶点、三角形依次放在 vertices 和 triangles 里面，每个等值面的范围见 getSurfaceRanges
+    * 每个 brick 由一个线程接着提取所有等值面，brick 的数据只从内存读一次；结果和分别运行每个等值面完全一样
+    * \param isoValues 等值面大小
+    **/
+    bool runAlgorithm(const std::vector<float>& isoValues, const CancellationToken* token = nullptr, const ProgressCallback& progress = nullptr);
+    /**
+    * 只提取 box 里面的等值面（比如一颗牙齿），只查询、读取、处理和 box 相交的 brick，运行时间和 box 的大小有关，和整个体数据的大小无关
+    * 顶点坐标仍然是在整个体数据中的坐标，box 超出体数据的部分会被去掉。closeBoundary 为 false 的时候结果和提取整个体数据之后
+    * 只保留 box 里面的 cube 完全一样
+    * \param box 体素范围 [box.lo, box.hi]
+    * \param closeBoundary 为 true 时把 box 截面（不在体数据边界上的面）上的体素当作在等值面外面，曲面在截面处封闭；为 false 时直接断开
     **/
-    void runAlgorithm(float isoValue);
+    bool runAlgorithm(float isoValue, const VoxelBox& box, bool closeBoundary = false, const CancellationToken* token = nullptr, const ProgressCallback& progress = nullptr);
+    /**
+    * 一次提取多个 box，每个 box 的结果各占一个范围（见 getSurfaceRanges，按 boxes 的顺序），box 之间重叠的部分会在每个 box 里面各输出一次
+    **/
+    bool runAlgorithm(float isoValue, const std::vector<VoxelBox>& boxes, bool closeBoundary = false, const CancellationToken* token = nullptr, const ProgressCallback& progress = nullptr);
+    // 一个等值面在 vertices 中的范围 [vertexBegin, vertexEnd)，在 triangles 中的范围 [triangleBegin, triangleEnd)
+    struct SurfaceRange {
+        int vertexBegin, vertexEnd, triangleBegin, triangleEnd;
+    };
+    // 上一次运行中每个等值面的范围，按 isoValues 或者 boxes 的顺序
+    inline const std::vector<SurfaceRange>& getSurfaceRanges() const {
+        return surfaceRanges;
+    }
     // bounding box
     float bmax[3], bmin[3], maxExtent;
     inline const std::vector<Vertex>& getVertices() const {
@@ -57,77 +86,126 @@ class MarchingCubes {
         return triangles;
     }
     void saveObj(std::string filename);
+    // brick 的边长（按 cube 计），每个 brick 由一个线程独立提取，用到的数据基本都在缓存里
+    int brickSize = 32;
+    // 生成三角形的方式，默认是带拓扑保证的 MC33；ALGORITHM_CLASSIC、ALGORITHM_FLYING_EDGES 更快但是可能有小孔，
+    // ALGORITHM_SURFACE_NETS 的顶点少、三角形形状好，ALGORITHM_ADAPTIVE 的三角形最少，见 MarchingAlgorithm
+    // ALGORITHM_FLYING_EDGES、ALGORITHM_SURFACE_NETS、ALGORITHM_ADAPTIVE 不分 brick，每次都重新提取整个 box，不用 brickSize、cacheFaceDecisions，也没有 getWorkerStats
+    MarchingAlgorithm algorithm = ALGORITHM_MC33;
+    // ALGORITHM_ADAPTIVE 合并八叉树叶子时允许的插值误差，和体数据的单位相同，越大三角形越少、越偏离原来的等值面
+    float adaptiveTolerance = 10;
+    // 为 true 时相邻的 cube 共用同一个面的测试结果（见 FaceDecisionCache），只测试用到的面；为 false 时每个 cube 批量测试全部 6 个面
+    bool cacheFaceDecisions = false;
+    // 为 true 时 ALGORITHM_MC33、ALGORITHM_CLASSIC 先数出每个 brick 的顶点数、三角形数，一次分配好 vertices、triangles 之后每个 brick 直接写到自己的位置，
+    // 不经过 brick 自己的缓冲区，内存峰值就是最终网格的大小；代价是每个 brick 的正负性和 cube 的测试要做两遍
+    bool exactAllocation = false;
+    /**
+     * \brief 找出可能和 isoValue 等值面相交的 brick 编号，只用到构造时建好的 min/max 八叉树，不读取数据
+     * 改变了 brickSize 的话会先按新的大小重新构建
+     */
+    void queryActiveBricks(float isoValue, std::vector<int>& bricks);
+    // 上一次运行中每个线程的忙碌、空闲时间，用来观察负载是否均衡
+    inline const std::vector<BrickScheduler::WorkerStats>& getWorkerStats() const {
+        return scheduler.getWorkerStats();
+    }
 
    private:
-    omp_lock_t vertexLock, triangleLock;
-    const unsigned short* data;
+    MarchingCubes(const void* data, VoxelType type, std::array<int, 3> dim, std::array<float, 3> spacing, bool reverseGradientDirection);
+    // 数据的类型为 voxelType
+    const void* data;
+    VoxelType voxelType;
     std::array<int, 3> dim;
     std::array<float, 3> spacing{1.f, 1.f, 1.f};
     bool reverseGradientDirection = false;
     std::vector<Vertex> vertices;
-    inline void addVertex(int i, int j, int k, concurrency::concurrent_unordered_map<glm::ivec3, int>& vertexIndex, const Vertex& v) {
-        omp_set_lock(&vertexLock);
-        vertices.push_back(v);
-        bmin[0] = std::min(bmin[0], v.x), bmax[0] = std::max(bmax[0], v.x);
-        bmin[1] = std::min(bmin[1], v.y), bmax[1] = std::max(bmax[1], v.y);
-        bmin[2] = std::min(bmin[2], v.z), bmax[2] = std::max(bmax[2], v.z);
-        vertexIndex[glm::ivec3(i, j, k)] = vertices.size() - 1;
-        omp_unset_lock(&vertexLock);
-    };
     // 所有的三角形，其中每个三角形是 3 个 Vertex 在 vertices 中的索引下标
     std::vector<std::array<int, 3>> triangles;
-    inline int addTriangle(const std::array<int, 3>& t) {
-        omp_set_lock(&triangleLock);
-        triangles.push_back(t);
-        omp_unset_lock(&triangleLock);
-        return triangles.size() - 1;
-    }
-    float isoValue;
-    inline float getData(int i, int j, int k) {
-        float val = data[i * dim[1] * dim[2] + j * dim[2] + k] - isoValue;
-        // 如果返回 0 的话，后面计算边的插值点的时候会出问题（要么插值就是 cube 顶点，要么不插值，都是不对的，前者会造成三角形塌陷成两个点，后者会造成没有顶点用来构成三角形）
-        if (abs(val) < FLT_EPSILON) {
-            val = FLT_EPSILON;
+    std::vector<SurfaceRange> surfaceRanges;
+    BrickGrid brickGrid;
+    // 每个 brick 体素值范围的 min/max 八叉树，构造时按 brickSize 建好
+    BrickHierarchy brickHierarchy;
+    // brickSize 和建好的 brickGrid 不一致的话重新划分 brick、重新构建 brickHierarchy
+    void updateBrickGrid();
+    // 一次运行中要提取的一个等值面：等值面大小和提取的范围
+    struct Surface {
+        float isoValue;
+        VoxelBox box;
+        bool closeBoundary;
+        inline bool operator==(const Surface& other) const {
+            return isoValue == other.isoValue && box == other.box && closeBoundary == other.closeBoundary;
         }
-        return val;
-    }
-
-    // xDirectionInterpolatedVertexIndex[i][j][k]
-    // 表示以 (i, j, k) 点向 x 方向的边上的插值顶点
-    // 注意对于两个点的正负性相同的边，中间是不需要插值顶点的
-    // x 方向又叫 horizontal 方向
-    // y 方向又叫 longitudinal 方向
-    // z 方向又叫 vertical 方向
-    // 对于有一些为了解决内部歧义的情况（例如 6.1.2），需要在 cube 正中间插值算一个顶点，这个顶点的标号为 12，存在 centerInterpolatedVertexIndex 里面，由于并不是所有 cube 都有 12，因此在 processCube 实际用到的时候才去添加
-    concurrency::concurrent_unordered_map<glm::ivec3, int>
-        xDirectionInterpolatedVertexIndex,
-        yDirectionInterpolatedVertexIndex,
-        zDirectionInterpolatedVertexIndex,
-        centerInterpolatedVertexIndex;
-    void computeInterpolatedVertices();
+    };
+    // 把 box 去掉超出体数据的部分之后作为一个等值面追加到 scratch.surfaces 中
+    void addSurface(float isoValue, VoxelBox box, bool closeBoundary);
+    // 各个 runAlgorithm 最后都调用这里，依次提取 surfaces 中的每个等值面
+    bool extractSurfaces(const std::vector<Surface>& surfaces, const CancellationToken* token, const ProgressCallback& progress);
+    // extractSurfaces 按 algorithm 调用下面两个之一，结果写到 vertices、triangles、surfaceRanges 和 bounding box 中
+    // 按 brick 提取再合并（ALGORITHM_MC33、ALGORITHM_CLASSIC）
+    bool extractBricks(const std::vector<Surface>& surfaces, const CancellationToken* token, const ProgressCallback& progress);
+    // exactAllocation 时代替 extractBricks 中的提取和合并：先计数、前缀和，再直接写入，见 BrickExtractor::count
+    bool extractBricksExact(const std::vector<std::pair<int, int>>& brickSurfaces, const std::vector<BrickExtractor::Settings>& settings, int64_t totalCost, const CancellationToken* token, const ProgressCallback& progress);
+    // ALGORITHM_FLYING_EDGES、ALGORITHM_SURFACE_NETS、ALGORITHM_ADAPTIVE：逐个等值面用 FlyingEdges 或 AdaptiveOctree 直接追加到 vertices、triangles 后面
+    bool extractFlyingEdges(const std::vector<Surface>& surfaces, const CancellationToken* token, const ProgressCallback& progress);
+    BrickExtractor::Settings getSettings(const Surface& surface) const;
+    // 找出可能和 surface 相交的 brick，只查询 box 范围内的节点
+    void queryActiveBricks(const Surface& surface, std::vector<int>& bricks);
+    // 上一次运行中与每个等值面相交的 brick，按编号排序
+    std::vector<std::vector<int>> activeBricks;
+    // 上一次运行的等值面，以及 vertices、triangles 是不是它们的结果
+    std::vector<Surface> surfaces;
+    MarchingAlgorithm resultAlgorithm = ALGORITHM_MC33;
+    float resultAdaptiveTolerance = 0;
+    bool hasResult = false;
+    // 每个等值面每个 brick 的提取结果，第 s 个等值面的第 b 个 brick 为 brickMeshes[s * brickGrid.size() + b]
+    // 保留容量，下一次运行可以直接复用
+    std::vector<BrickMesh> brickMeshes;
+    // 每个线程一个
+    std::vector<BrickExtractor> extractors;
+    FlyingEdges flyingEdges;
+    AdaptiveOctree adaptiveOctree;
+    // 每个 brick 估计的工作量，见 estimateBrickCosts
+    std::vector<int64_t> brickCosts;
+    // 当前运行中已经完成的工作量，以及已经报告过的百分比，只用原子操作更新
+    std::atomic<int64_t> completedCost{0};
+    std::atomic<int> reportedPercent{0};
+    // 提取完工作量为 cost 的 brick 之后调用，完成的百分比增加了的话调用 progress
+    void reportProgress(int64_t cost, int64_t totalCost, const ProgressCallback& progress);
+    // extractFlyingEdges 里面每个等值面的工作量都算 SURFACE_COST，FlyingEdges、AdaptiveOctree 报告的进度按比例换算，
+    // surfacesCost 是所有等值面的总工作量
+    static const int64_t SURFACE_COST = 1 << 20;
+    int64_t surfacesCost = 0;
+    BrickScheduler scheduler;
+    // 一次运行中用到的临时数组，保留容量，拖动滑块反复运行的时候不用重新分配
+    struct Scratch {
+        // runAlgorithm 的参数整理成的等值面
+        std::vector<Surface> surfaces;
+        // 按 brick 编号排好序的 (brick, 等值面编号)，以及每个等值面的提取参数
+        std::vector<std::pair<int, int>> brickSurfaces;
+        std::vector<BrickExtractor::Settings> settings;
+        // estimateBrickCosts 中每个等值面的阈值、brickSurfaces 中每一项的工作量
+        std::vector<float> thresholds;
+        std::vector<int64_t> costs;
+        // 每个 brickMesh 在最终结果中的偏移，最后一个元素是总数
+        std::vector<int> vertexOffset, triangleOffset;
+        // 每个线程一个，见 getSeamIndex
+        std::vector<std::vector<int>> seamIndex;
+    } scratch;
     /**
-     * \brief 在 cube 正中心生成一个 vertex 并放入 centerInterpolatedVertexIndex 中
+     * \brief 估计 brickSurfaces 中每个 brick（在 box 里面的部分）与等值面相交的 cube 数，同一个 brick 的多个等值面加在一起，其他 brick 为 0
+     * 每隔 COST_SAMPLE_STRIDE 个平面、每隔 COST_SAMPLE_STRIDE 行取一行，数这一行上 z 方向跨过等值面的边，
+     * 每条这样的边大致代表 COST_SAMPLE_STRIDE^2 个相交的 cube，只读取 1/16 的数据。
+     * 没有相交的 brick 也要构建正负性，所以每个 brick 至少为 1
      */
-    void addCenterVertex(int i, int j, int k);
-    // 给定 cube 坐标和 edge 编号，求出 vertex 编号
-    int getCubeVertexIndex(int i, int j, int k, int edgeIdx);
-
-    // 梯度方向就是法向量方向
-    inline float getXGradient(int i, int j, int k);
-    inline float getYGradient(int i, int j, int k);
-    inline float getZGradient(int i, int j, int k);
-    inline std::array<float, 3> getNormal(int i, int j, int k);
-
-    void processCube(int i, int j, int k, int configurationIndex, const std::vector<float>& cube);
-    // 根据 tiling 数组里面的需要连接的边，连接对应的三角形
-    void addTriangle(int i, int j, int k, std::vector<char> edges);
-    float testFace(int i, int j, int k, const std::vector<float>& cube, int f);
+    void estimateBrickCosts(const std::vector<Surface>& surfaces, const std::vector<std::pair<int, int>>& brickSurfaces);
+    static const int COST_SAMPLE_STRIDE = 4;
     /**
-     * \brief 测试内部
-     * \param caseIdx 论文中规定的 0-14 种 case
-     * \param alongEdgeIdx 表示插值平面 P 的方向, the direction of P is encoded as an edge
-     * e inside one particular sequence of the tiling table，主要还是关心这个值得正负性，在结果上会乘上这个
-     * \param edgeIdx 表示这条边的两个点当做两个 A0 和 A1 点
+     * \brief 将所有等值面所有 brick 的结果依次合并到 vertices 和 triangles 中，并记下每个等值面的范围
+     * 先对每个 brick 的顶点数、三角形数做前缀和得到各自的全局偏移，然后并行地拷贝并把三角形里的 handle 换成全局下标，
+     * 引用相邻 brick 的顶点在所属 brick 的 seamVertices 中查找，bounding box 也在这里归约
      */
-    float testInterior(int i, int j, int k, const std::vector<float>& cube, int caseIdx, int alongEdgeIdx, int edgeIdx);
+    void mergeBrickMeshes();
+    // 把第 m 个 brickMesh 的 seamRefs 对应的全局下标写到 seamIndex 中，vertexOffset 是每个 brickMesh 的顶点在最终结果中的偏移
+    void getSeamIndex(int m, const std::vector<int>& vertexOffset, std::vector<int>& seamIndex) const;
+    // 按每个 brickMesh 的偏移记下每个等值面的范围，并且归约 bounding box
+    void finishBrickMeshes(const std::vector<int>& vertexOffset, const std::vector<int>& triangleOffset);
 };
@@ -0,0 +1,73 @@
+﻿#include <algorithm>
+#include <cassert>
+#include <limits>
+
+#include "marching_cubes.h"
+
+void MarchingCubes::mergeBrickMeshes() {
+    int meshes = brickMeshes.size();
+    // 每个 brick 在最终结果中的偏移，最后一个元素是总数
+    auto &vertexOffset = scratch.vertexOffset, &triangleOffset = scratch.triangleOffset;
+    vertexOffset.assign(meshes + 1, 0);
+    triangleOffset.assign(meshes + 1, 0);
+    for (int m = 0; m < meshes; m++) {
+        vertexOffset[m + 1] = vertexOffset[m] + brickMeshes[m].vertices.size();
+        triangleOffset[m + 1] = triangleOffset[m] + brickMeshes[m].triangles.size();
+    }
+    resizeOutput(vertices, vertexOffset[meshes], Vertex(0, 0, 0, 0, 0, 1));
+    resizeOutput(triangles, triangleOffset[meshes]);
+
+    scratch.seamIndex.resize(omp_get_max_threads());
+#pragma omp parallel
+    {
+        std::vector<int>& seamIndex = scratch.seamIndex[omp_get_thread_num()];
+#pragma omp for schedule(dynamic)
+        for (int m = 0; m < meshes; m++) {
+            const auto& mesh = brickMeshes[m];
+            if (mesh.triangles.empty() && mesh.vertices.empty()) continue;
+            std::copy(mesh.vertices.begin(), mesh.vertices.end(), vertices.begin() + vertexOffset[m]);
+            // 先把引用的相邻 brick 的顶点换成全局下标
+            getSeamIndex(m, vertexOffset, seamIndex);
+            for (int t = 0; t < mesh.triangles.size(); t++) {
+                auto& triangle = triangles[triangleOffset[m] + t];
+                for (int c = 0; c < 3; c++) {
+                    int handle = mesh.triangles[t][c];
+                    triangle[c] = handle < BrickMesh::SEAM ? vertexOffset[m] + handle : seamIndex[handle - BrickMesh::SEAM];
+                }
+            }
+        }
+    }
+    finishBrickMeshes(vertexOffset, triangleOffset);
+}
+
+void MarchingCubes::getSeamIndex(int m, const std::vector<int>& vertexOffset, std::vector<int>& seamIndex) const {
+    // 所属 brick 的 seamVertices 是按 edge key 排好序的
+    const auto& mesh = brickMeshes[m];
+    int bricks = brickGrid.size();
+    seamIndex.resize(mesh.seamRefs.size());
+    for (int r = 0; r < mesh.seamRefs.size(); r++) {
+        int owner = m - m % bricks + mesh.seamRefs[r].first;
+        const auto& seamVertices = brickMeshes[owner].seamVertices;
+        auto it = std::lower_bound(seamVertices.begin(), seamVertices.end(), std::make_pair(mesh.seamRefs[r].second, std::numeric_limits<int>::min()));
+        assert(it != seamVertices.end() && it->first == mesh.seamRefs[r].second);
+        seamIndex[r] = vertexOffset[owner] + it->second;
+    }
+}
+
+void MarchingCubes::finishBrickMeshes(const std::vector<int>& vertexOffset, const std::vector<int>& triangleOffset) {
+    int meshes = brickMeshes.size(), bricks = brickGrid.size();
+    // 同一个等值面的 brick 是连续的
+    surfaceRanges.clear();
+    for (int m = 0; m < meshes; m += bricks) {
+        surfaceRanges.push_back({vertexOffset[m], vertexOffset[m + bricks], triangleOffset[m], triangleOffset[m + bricks]});
+    }
+    // 每个 brick 的 bounding box 已经在添加顶点的时候各自算好了，这里只需要归约；
+    // 从来没有提取过的 brick 的 bounding box 没有初始化，没有顶点的 brick 直接跳过
+    for (int m = 0; m < meshes; m++) {
+        if (vertexOffset[m + 1] == vertexOffset[m]) continue;
+        for (int d = 0; d < 3; d++) {
+            bmin[d] = std::min(bmin[d], brickMeshes[m].bmin[d]);
+            bmax[d] = std::max(bmax[d], brickMeshes[m].bmax[d]);
+        }
+    }
+}
@@ -39,6 +39,11 @@ void MeshViewWidget::setMarchingCubes(MarchingCubes *mc) {
         }
         indexBuf.allocate(mc->getTriangles().data(), mc->getTriangles().size() * sizeof(int) * 3);
         doneCurrent();
+        triangleCount = mc->getTriangles().size();
+        for (int d = 0; d < 3; d++) {
+            center[d] = 0.5 * (mc->bmax[d] + mc->bmin[d]);
+        }
+        maxExtent = mc->maxExtent;
     }
 }
 
@@ -170,11 +175,8 @@ void MeshViewWidget::paintGL() {
 
     // Calculate model view transformation
     QMatrix4x4 translate, scale, rotate, model;
-    translate.translate(
-        -0.5 * (mc->bmax[0] + mc->bmin[0]),
-        -0.5 * (mc->bmax[1] + mc->bmin[1]),
-        -0.5 * (mc->bmax[2] + mc->bmin[2]));
-    scale.scale(1.0 / mc->maxExtent);
+    translate.translate(-center[0], -center[1], -center[2]);
+    scale.scale(1.0 / maxExtent);
     rotate.rotate(QQuaternion(curr_quat[3], -curr_quat[0], -curr_quat[1], -curr_quat[2]));
     model = rotate * scale * translate;
 
@@ -215,6 +217,6 @@ void MeshViewWidget::paintGL() {
     // glPolygonMode(GL_FRONT_AND_BACK,GL_FILL);
     GLCheckError();
     // type: Must be one of GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, or GL_UNSIGNED_INT.
-    glDrawElements(GL_TRIANGLES, mc->getTriangles().size() * 3, GL_UNSIGNED_INT, nullptr);
+    glDrawElements(GL_TRIANGLES, triangleCount * 3, GL_UNSIGNED_INT, nullptr);
     GLCheckError();
 }
@@ -36,6 +36,9 @@ class MeshViewWidget : public QOpenGLWidget, protected QOpenGLFunctions {
 
    private:
     MarchingCubes *mc = nullptr;
+    // setMarchingCubes 时拷贝下来的三角形数和 bounding box，之后 mc 可能在后台线程中被重新运行，绘制的时候不能再读取
+    int triangleCount = 0;
+    float center[3] = {0, 0, 0}, maxExtent = 1;
     QOpenGLShaderProgram program;
 
     QMatrix4x4 projection;
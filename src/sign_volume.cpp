@@ -0,0 +1,224 @@
+﻿#include "sign_volume.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include "simd.h"
+
+// 和 MarchingCubes::getData 的判断方式保持一致
+static inline bool isPositive(float v, float isoValue) {
+    float val = v - isoValue;
+    return val > 0 || std::abs(val) < FLT_EPSILON;
+}
+
+template <typename T>
+static float integerThreshold(float isoValue) {
+    const int lowest = std::numeric_limits<T>::lowest(), highest = std::numeric_limits<T>::max();
+    int t = (int)std::floor(std::min(std::max(isoValue, lowest - 1.f), highest + 2.f)) - 1;
+    t = std::min(std::max(t, lowest), highest + 1);
+    while (t > lowest && isPositive(t - 1, isoValue)) t--;
+    while (t <= highest && !isPositive(t, isoValue)) t++;
+    return t;
+}
+
+static float floatThreshold(float isoValue) {
+    // v - isoValue 关于 v 单调，从 isoValue - FLT_EPSILON 附近按 ulp 调整，只需要走几步
+    const float inf = std::numeric_limits<float>::infinity();
+    float t = isoValue - FLT_EPSILON;
+    while (t > -inf && isPositive(std::nextafter(t, -inf), isoValue)) t = std::nextafter(t, -inf);
+    while (t < inf && !isPositive(t, isoValue)) t = std::nextafter(t, inf);
+    return t;
+}
+
+float SignVolume::threshold(VoxelType type, float isoValue) {
+    switch (type) {
+        case VOXEL_UINT8:
+            return integerThreshold<unsigned char>(isoValue);
+        case VOXEL_INT16:
+            return integerThreshold<short>(isoValue);
+        case VOXEL_UINT16:
+            return integerThreshold<unsigned short>(isoValue);
+        case VOXEL_FLOAT:
+            return floatThreshold(isoValue);
+    }
+    return 0;
+}
+
+void SignVolume::reset(std::array<int, 3> dim, std::array<int, 3> lo, std::array<int, 3> hi, VoxelType type, float isoValue) {
+    this->dim = dim, this->lo = lo, this->hi = hi;
+    rows = hi[1] - lo[1] + 1;
+    wordsPerRow = (hi[2] - lo[2] + 1 + 63) / 64;
+    bits.resize((size_t)SLOTS * rows * wordsPerRow);
+    this->type = type;
+    valueThreshold = threshold(type, isoValue);
+}
+
+// 每种体素类型的 SIMD 部分：从 k = 0 开始按块处理 rowData[k] >= t，返回处理到的位置，剩下的逐个处理
+static int buildRowSimd(const unsigned char* rowData, int n, int t, uint64_t* rowBits) {
+    if (t >= 256) return n;
+    int k = 0;
+#if defined(MC_SIMD_AVX2)
+    // v >= t 等价于饱和减法 t - v 的结果为 0，一个字节一位，正好对应 movemask
+    const __m256i thr = _mm256_set1_epi8((char)t), zero = _mm256_setzero_si256();
+    for (; k + 32 <= n; k += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(rowData + k));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_subs_epu8(thr, v), zero));
+        rowBits[k >> 6] |= (uint64_t)mask << (k & 63);
+    }
+#elif defined(MC_SIMD_SSE2)
+    const __m128i thr = _mm_set1_epi8((char)t), zero = _mm_setzero_si128();
+    for (; k + 16 <= n; k += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(rowData + k));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_subs_epu8(thr, v), zero));
+        rowBits[k >> 6] |= (uint64_t)mask << (k & 63);
+    }
+#endif
+    return k;
+}
+
+static int buildRowSimd(const short* rowData, int n, int t, uint64_t* rowBits) {
+    if (t >= 32768) return n;
+    int k = 0;
+    // v >= t 等价于有符号比较 v > t - 1，t 为最小值的时候 t - 1 会溢出，交给逐个处理
+    if (t > -32768) {
+#if defined(MC_SIMD_AVX2)
+        const __m256i thr = _mm256_set1_epi16((short)(t - 1));
+        for (; k + 32 <= n; k += 32) {
+            __m256i ge0 = _mm256_cmpgt_epi16(_mm256_loadu_si256((const __m256i*)(rowData + k)), thr);
+            __m256i ge1 = _mm256_cmpgt_epi16(_mm256_loadu_si256((const __m256i*)(rowData + k + 16)), thr);
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(ge0, ge1), _MM_SHUFFLE(3, 1, 2, 0));
+            uint32_t mask = (uint32_t)_mm256_movemask_epi8(packed);
+            rowBits[k >> 6] |= (uint64_t)mask << (k & 63);
+        }
+#elif defined(MC_SIMD_SSE2)
+        const __m128i thr = _mm_set1_epi16((short)(t - 1));
+        for (; k + 16 <= n; k += 16) {
+            __m128i ge0 = _mm_cmpgt_epi16(_mm_loadu_si128((const __m128i*)(rowData + k)), thr);
+            __m128i ge1 = _mm_cmpgt_epi16(_mm_loadu_si128((const __m128i*)(rowData + k + 8)), thr);
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_packs_epi16(ge0, ge1));
+            rowBits[k >> 6] |= (uint64_t)mask << (k & 63);
+        }
+#endif
+    }
+    return k;
+}
+
+static int buildRowSimd(const unsigned short* rowData, int n, int t, uint64_t* rowBits) {
+    if (t >= 65536) return n;
+    int k = 0;
+    if (t > 0) {
+#if defined(MC_SIMD_AVX2)
+        // v >= t 等价于饱和减法 t - v 的结果为 0
+        const __m256i thr = _mm256_set1_epi16((short)t), zero = _mm256_setzero_si256();
+        for (; k + 32 <= n; k += 32) {
+            __m256i v0 = _mm256_loadu_si256((const __m256i*)(rowData + k));
+            __m256i v1 = _mm256_loadu_si256((const __m256i*)(rowData + k + 16));
+            __m256i ge0 = _mm256_cmpeq_epi16(_mm256_subs_epu16(thr, v0), zero);
+            __m256i ge1 = _mm256_cmpeq_epi16(_mm256_subs_epu16(thr, v1), zero);
+            // packs 是按 128 位 lane 交错的，需要把顺序换回来
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(ge0, ge1), _MM_SHUFFLE(3, 1, 2, 0));
+            uint32_t mask = (uint32_t)_mm256_movemask_epi8(packed);
+            rowBits[k >> 6] |= (uint64_t)mask << (k & 63);
+        }
+#elif defined(MC_SIMD_SSE2)
+        const __m128i thr = _mm_set1_epi16((short)t), zero = _mm_setzero_si128();
+        for (; k + 16 <= n; k += 16) {
+            __m128i v0 = _mm_loadu_si128((const __m128i*)(rowData + k));
+            __m128i v1 = _mm_loadu_si128((const __m128i*)(rowData + k + 8));
+            __m128i ge0 = _mm_cmpeq_epi16(_mm_subs_epu16(thr, v0), zero);
+            __m128i ge1 = _mm_cmpeq_epi16(_mm_subs_epu16(thr, v1), zero);
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_packs_epi16(ge0, ge1));
+            rowBits[k >> 6] |= (uint64_t)mask << (k & 63);
+        }
+#endif
+    }
+    return k;
+}
+
+static int buildRowSimd(const float* rowData, int n, float t, uint64_t* rowBits) {
+    int k = 0;
+#if defined(MC_SIMD_AVX2)
+    const __m256 thr = _mm256_set1_ps(t);
+    for (; k + 8 <= n; k += 8) {
+        uint32_t mask = (uint32_t)_mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(rowData + k), thr, _CMP_GE_OQ));
+        rowBits[k >> 6] |= (uint64_t)mask << (k & 63);
+    }
+#elif defined(MC_SIMD_SSE2)
+    const __m128 thr = _mm_set1_ps(t);
+    for (; k + 4 <= n; k += 4) {
+        uint32_t mask = (uint32_t)_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(rowData + k), thr));
+        rowBits[k >> 6] |= (uint64_t)mask << (k & 63);
+    }
+#endif
+    return k;
+}
+
+template <typename T>
+static void buildRowBits(const T* rowData, int n, float threshold, uint64_t* rowBits) {
+    // 整数类型的阈值本来就是整数，转成 int 之后做整数比较
+    typedef typename std::conditional<std::is_integral<T>::value, int, float>::type Threshold;
+    Threshold t = (Threshold)threshold;
+    int k = buildRowSimd(rowData, n, t, rowBits);
+    for (; k < n; k++) {
+        if (rowData[k] >= t) {
+            rowBits[k >> 6] |= (uint64_t)1 << (k & 63);
+        }
+    }
+}
+
+void SignVolume::buildPlane(const void* data, int i) {
+    uint64_t* plane = bits.data() + (size_t)(i & (SLOTS - 1)) * rows * wordsPerRow;
+    int n = hi[2] - lo[2] + 1;
+    for (int j = lo[1]; j <= hi[1]; j++) {
+        classifyRow(type, data, ((size_t)i * dim[1] + j) * dim[2] + lo[2], n, valueThreshold, plane + (size_t)(j - lo[1]) * wordsPerRow);
+    }
+}
+
+void SignVolume::classifyRow(VoxelType type, const void* data, size_t offset, int n, float threshold, uint64_t* rowBits) {
+    std::memset(rowBits, 0, (n + 63) / 64 * sizeof(uint64_t));
+    dispatchVoxelType(type, data, [&](auto typed) {
+        buildRowBits(typed + offset, n, threshold, rowBits);
+    });
+}
+
+void SignVolume::compactRow(int i, int j, std::vector<ActiveCell>& activeCells) const {
+    // 编号 0, 1, 2, 3 的点分别在 (i, j), (i + 1, j), (i + 1, j + 1), (i, j + 1) 这 4 行上
+    const uint64_t* rows[4] = {row(i, j), row(i + 1, j), row(i + 1, j + 1), row(i, j + 1)};
+    compactRow(rows, hi[2] - lo[2], j, lo[2], activeCells);
+}
+
+void SignVolume::compactRow(const uint64_t* const rows[4], int n, int j, int kBegin, std::vector<ActiveCell>& activeCells) {
+    // 4, 5, 6, 7 号点是 0, 1, 2, 3 号点所在行的下一个体素
+    int wordsPerRow = (n + 1 + 63) / 64;
+    for (int w = 0; w * 64 < n; w++) {
+        uint64_t word[8];
+        for (int r = 0; r < 4; r++) {
+            word[r] = rows[r][w];
+            // 右移一位得到 k + 1 处的体素，最高位从下一个字借过来
+            word[r + 4] = (word[r] >> 1) | (w + 1 < wordsPerRow ? rows[r][w + 1] << 63 : 0);
+        }
+        int count = std::min(64, n - w * 64);
+        uint64_t any = 0, all = ~(uint64_t)0;
+        for (int l = 0; l < 8; l++) {
+            any |= word[l];
+            all &= word[l];
+        }
+        uint64_t valid = count == 64 ? ~(uint64_t)0 : ((uint64_t)1 << count) - 1;
+        // 8 个顶点不全相同的 cube 才会产生三角形，一次处理 64 个 cube，只遍历为 1 的位
+        uint64_t active = any & ~all & valid;
+        while (active) {
+            int kk = countTrailingZeros(active);
+            active &= active - 1;
+            unsigned int configurationIndex = 0;
+            for (int l = 0; l < 8; l++) {
+                configurationIndex |= ((word[l] >> kk) & 1) << l;
+            }
+            // 子类编号之后由 AmbiguityQueue::resolve 确定
+            activeCells.push_back({j, kBegin + w * 64 + kk, (unsigned char)configurationIndex, 0});
+        }
+    }
+}
@@ -0,0 +1,100 @@
+﻿#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "voxel_type.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+inline int countTrailingZeros(uint64_t x) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return index;
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+inline int countBits(uint64_t x) {
+#ifdef _MSC_VER
+    return (int)__popcnt64(x);
+#else
+    return __builtin_popcountll(x);
+#endif
+}
+
+// 与等值面相交的 cube，i 由所在的 slab 决定
+struct ActiveCell {
+    int j, k;
+    unsigned char configurationIndex;
+    // 确定下来的子类编号，见 tiling_table.h
+    unsigned char subcase;
+};
+
+/**
+ * \brief 一个 brick 中每个体素 1 bit 的正负性，只保存最近的 SLOTS 个平面
+ *
+ * brick 的体素范围为 [lo, hi]，第 (i, j) 行的 hi[2] - lo[2] + 1 个体素依次存放在 wordsPerRow 个 uint64_t 里面，
+ * 第 k 个体素是第 (k - lo[2]) / 64 个字的第 (k - lo[2]) % 64 位。
+ * bit 为 1 表示 getData(i, j, k) > 0，和 MarchingCubes::getData 的 FLT_EPSILON 处理完全一致。
+ * 构建时直接用 SIMD 比较原始类型的数据（整数类型用整数比较），不需要转成 float，大小只有 16 位数据的 1/16。
+ * 和 SlabEdgeIndex 一样是环形缓冲区，第 i 个平面存放在 i & (SLOTS - 1) 的位置上，随着 brick 内部逐个平面推进而构建。
+ */
+class SignVolume {
+   public:
+    // 同时用到的平面数：处理第 i 层 cube 需要第 i, i + 1 个平面，生成第 i + 1 个平面的插值顶点还需要第 i + 2 个平面
+    static const int SLOTS = 4;
+    /**
+     * \brief 开始处理体素范围为 [lo, hi] 的 brick
+     */
+    void reset(std::array<int, 3> dim, std::array<int, 3> lo, std::array<int, 3> hi, VoxelType type, float isoValue);
+    /**
+     * \brief 计算第 i 个平面 brick 范围内所有体素的正负性，覆盖掉第 i - SLOTS 个平面，data 的类型为 reset 时的 type
+     */
+    void buildPlane(const void* data, int i);
+    /**
+     * \brief 用 8 个相邻的 bit 行拼出第 i 层第 j 行 cube 的 configuration 编号，只把与等值面相交的 cube（编号不为 0 和 255）追加到 activeCells 中
+     */
+    void compactRow(int i, int j, std::vector<ActiveCell>& activeCells) const;
+    /**
+     * \brief 同上，rows 是 cube 的 0, 1, 2, 3 号点所在的 4 个 bit 行，每行 n + 1 个体素，第一个体素的坐标为 kBegin
+     * 不依赖 SignVolume 的存储方式，FlyingEdges 也用这个函数
+     */
+    static void compactRow(const uint64_t* const rows[4], int n, int j, int kBegin, std::vector<ActiveCell>& activeCells);
+    /**
+     * \brief 计算 type 类型的 data[offset, offset + n) 这 n 个体素的正负性，写到 (n + 63) / 64 个字的 rowBits 中
+     * 值 >= threshold（见 threshold 函数）的体素为 1，按类型分派到对应的 SIMD 内核
+     */
+    static void classifyRow(VoxelType type, const void* data, size_t offset, int n, float threshold, uint64_t* rowBits);
+    inline const uint64_t* row(int i, int j) const {
+        return bits.data() + ((size_t)(i & (SLOTS - 1)) * rows + j - lo[1]) * wordsPerRow;
+    }
+    inline uint64_t* row(int i, int j) {
+        return bits.data() + ((size_t)(i & (SLOTS - 1)) * rows + j - lo[1]) * wordsPerRow;
+    }
+    inline bool get(int i, int j, int k) const {
+        return (row(i, j)[(k - lo[2]) >> 6] >> ((k - lo[2]) & 63)) & 1;
+    }
+    inline int getWordsPerRow() const {
+        return wordsPerRow;
+    }
+    /**
+     * \brief 求出 type 类型的体素值中最小的 t 使得 v >= t 时 getData 为正
+     * getData 的结果关于 v 单调，所以可以把浮点比较换成和 t 的比较。整数类型的 t 是整数，可以直接做整数比较，
+     * 所有体素都为负时为类型的最大值 + 1；float 类型所有体素都为负时为 +inf
+     */
+    static float threshold(VoxelType type, float isoValue);
+
+   private:
+    std::array<int, 3> dim{0, 0, 0}, lo{0, 0, 0}, hi{0, 0, 0};
+    int rows = 0, wordsPerRow = 0;
+    VoxelType type = VOXEL_UINT16;
+    float valueThreshold = 0;
+    std::vector<uint64_t> bits;
+};
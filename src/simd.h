@@ -0,0 +1,109 @@
+﻿#pragma once
+// 各个 SIMD 内核共用的指令集选择和按行处理的小函数
+// AVX2 需要打开对应的编译选项（见 CMakeLists.txt 的 ENABLE_AVX2），x64 上至少有 SSE2
+
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define MC_SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MC_SIMD_SSE2
+#endif
+
+namespace simd {
+
+#if defined(MC_SIMD_AVX2)
+// 读取 8 个体素转成 float，每种体素类型一个重载
+inline __m256 load8(const unsigned char* src) {
+    return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)src)));
+}
+inline __m256 load8(const short* src) {
+    return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)src)));
+}
+inline __m256 load8(const unsigned short* src) {
+    return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)src)));
+}
+inline __m256 load8(const float* src) {
+    return _mm256_loadu_ps(src);
+}
+#elif defined(MC_SIMD_SSE2)
+// 读取 4 个体素转成 float，每种体素类型一个重载
+inline __m128 load4(const unsigned char* src) {
+    const __m128i zero = _mm_setzero_si128();
+    int bytes;
+    std::memcpy(&bytes, src, 4);
+    __m128i v = _mm_cvtsi32_si128(bytes);
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(v, zero), zero));
+}
+inline __m128 load4(const short* src) {
+    // 把 16 位放到高半部分再算术右移，完成符号扩展
+    __m128i v = _mm_loadl_epi64((const __m128i*)src);
+    return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+}
+inline __m128 load4(const unsigned short* src) {
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)src), _mm_setzero_si128()));
+}
+inline __m128 load4(const float* src) {
+    return _mm_loadu_ps(src);
+}
+#endif
+
+/**
+ * \brief dst[k] = src[k] - isoValue，绝对值小于 FLT_EPSILON 的改为 FLT_EPSILON，和 MarchingCubes::getData 一致
+ * T 为 VoxelType 中的一种，不超过 16 位的整数转成 float 没有误差，所以 SIMD 和逐个计算的结果完全相同
+ */
+template <typename T>
+inline void loadRow(const T* src, float isoValue, float* dst, int n) {
+    int k = 0;
+#if defined(MC_SIMD_AVX2)
+    const __m256 iso = _mm256_set1_ps(isoValue), eps = _mm256_set1_ps(FLT_EPSILON), absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    for (; k + 8 <= n; k += 8) {
+        __m256 val = _mm256_sub_ps(load8(src + k), iso);
+        __m256 small = _mm256_cmp_ps(_mm256_and_ps(val, absMask), eps, _CMP_LT_OQ);
+        _mm256_storeu_ps(dst + k, _mm256_blendv_ps(val, eps, small));
+    }
+#elif defined(MC_SIMD_SSE2)
+    const __m128 iso = _mm_set1_ps(isoValue), eps = _mm_set1_ps(FLT_EPSILON), absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    for (; k + 4 <= n; k += 4) {
+        __m128 val = _mm_sub_ps(load4(src + k), iso);
+        __m128 small = _mm_cmplt_ps(_mm_and_ps(val, absMask), eps);
+        _mm_storeu_ps(dst + k, _mm_or_ps(_mm_andnot_ps(small, val), _mm_and_ps(small, eps)));
+    }
+#endif
+    for (; k < n; k++) {
+        float val = src[k] - isoValue;
+        if (std::abs(val) < FLT_EPSILON) {
+            val = FLT_EPSILON;
+        }
+        dst[k] = val;
+    }
+}
+
+/**
+ * \brief dst[k] = (a[k] - b[k]) / divisor * sign，用来按行计算差分梯度
+ */
+inline void differenceRow(const float* a, const float* b, float divisor, float sign, float* dst, int n) {
+    int k = 0;
+#if defined(MC_SIMD_AVX2)
+    const __m256 div = _mm256_set1_ps(divisor), s = _mm256_set1_ps(sign);
+    for (; k + 8 <= n; k += 8) {
+        __m256 diff = _mm256_sub_ps(_mm256_loadu_ps(a + k), _mm256_loadu_ps(b + k));
+        _mm256_storeu_ps(dst + k, _mm256_mul_ps(_mm256_div_ps(diff, div), s));
+    }
+#elif defined(MC_SIMD_SSE2)
+    const __m128 div = _mm_set1_ps(divisor), s = _mm_set1_ps(sign);
+    for (; k + 4 <= n; k += 4) {
+        __m128 diff = _mm_sub_ps(_mm_loadu_ps(a + k), _mm_loadu_ps(b + k));
+        _mm_storeu_ps(dst + k, _mm_mul_ps(_mm_div_ps(diff, div), s));
+    }
+#endif
+    for (; k < n; k++) {
+        dst[k] = (a[k] - b[k]) / divisor * sign;
+    }
+}
+
+}  // namespace simd
@@ -0,0 +1,43 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <vector>
+
+/**
+ * \brief 由三个 slab 组成的环形缓冲区，稠密地存储一个 brick 中每个格点 x, y, z 方向边上插值顶点的编号
+ *
+ * slab 指的是 i 固定时 brick 范围内 (j, k) 的一个平面。处理第 i 层 cube 的时候只会用到第 i 和第 i + 1 个平面上的边，
+ * 因此只需要保存最近的几个平面，第 i 个平面存放在 i % 3 的位置上，计算第 i + 3 个平面的时候直接覆盖掉第 i 个平面。
+ * 这样内存只和 brick 的截面大小相关，查找一条边只需要一次数组访问。
+ * 没有插值顶点的边存的是 -1。
+ */
+class SlabEdgeIndex {
+   public:
+    // 开始处理一个 brick，格点范围为 [jBegin, jBegin + rows) * [kBegin, kBegin + cols)
+    void reset(int jBegin, int rows, int kBegin, int cols) {
+        this->jBegin = jBegin, this->kBegin = kBegin, this->cols = cols;
+        for (auto& slab : slabs) {
+            for (auto& axis : slab) {
+                axis.assign(rows * cols, -1);
+            }
+        }
+    }
+    // 开始计算第 i 个平面之前调用，清除掉环形缓冲区里面之前 i - 3 平面的数据
+    void resetSlab(int i) {
+        for (auto& axis : slabs[i % SLOTS]) {
+            std::fill(axis.begin(), axis.end(), -1);
+        }
+    }
+    // axis 为 0, 1, 2 分别表示 x, y, z 方向
+    inline int get(int axis, int i, int j, int k) const {
+        return slabs[i % SLOTS][axis][(j - jBegin) * cols + k - kBegin];
+    }
+    inline void set(int axis, int i, int j, int k, int vertexIndex) {
+        slabs[i % SLOTS][axis][(j - jBegin) * cols + k - kBegin] = vertexIndex;
+    }
+
+   private:
+    static const int SLOTS = 3;
+    int jBegin = 0, kBegin = 0, cols = 0;
+    std::vector<int> slabs[SLOTS][3];
+};
@@ -0,0 +1,75 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <vector>
+
+/**
+ * \brief 按 slab 缓存的数据值和法线（梯度）
+ *
+ * 计算第 i 个平面的插值顶点时，需要第 i 和 i + 1 个平面上的法线，而计算这两个平面的法线又需要第 i - 1 到 i + 2 个平面上的数据值。
+ * 因此数据值保存 4 个平面，法线保存 2 个平面（每个平面 x, y, z 三个分量各一个 float 平面），都按行懒惰计算：
+ * 只有跨过等值面的边用到的行才会算，算过之后被这一行相邻的所有边共用。平面编号对环的大小取模得到槽位，
+ * 槽位被新的平面占用时之前的数据就被淘汰了。只保存当前 brick 的行 [jBegin, jEnd)，每一行保存 rowLength 个体素
+ * （包括 brick 两侧各一个用来求梯度的体素，从哪个体素开始由调用者决定），内存只和 brick 的截面大小相关。
+ */
+class SlabGradientCache {
+   public:
+    // 开始处理一个 brick，之前缓存的所有平面都作废
+    void reset(int jBegin, int jEnd, int rowLength) {
+        this->jBegin = jBegin, this->rowLength = rowLength;
+        int rows = jEnd - jBegin;
+        for (int s = 0; s < VALUE_SLOTS; s++) {
+            values[s].resize(rows * rowLength);
+            valueReady[s].assign(rows, 0);
+            valuePlane[s] = -1;
+        }
+        for (int s = 0; s < NORMAL_SLOTS; s++) {
+            for (auto& component : normals[s]) {
+                component.resize(rows * rowLength);
+            }
+            normalReady[s].assign(rows, 0);
+            normalPlane[s] = -1;
+        }
+    }
+    /**
+     * \brief 处理第 i 个平面之前调用，把 i - 1 到 i + 2 的数据槽位和 i, i + 1 的法线槽位分配给对应的平面
+     * 槽位原来属于别的平面的话，清空其中的标记
+     */
+    void claim(int i) {
+        for (int p = i - 1; p <= i + 2; p++) {
+            int s = p & (VALUE_SLOTS - 1);
+            if (p >= 0 && valuePlane[s] != p) {
+                valuePlane[s] = p;
+                std::fill(valueReady[s].begin(), valueReady[s].end(), 0);
+            }
+        }
+        for (int p = i; p <= i + 1; p++) {
+            int s = p & (NORMAL_SLOTS - 1);
+            if (normalPlane[s] != p) {
+                normalPlane[s] = p;
+                std::fill(normalReady[s].begin(), normalReady[s].end(), 0);
+            }
+        }
+    }
+    inline float* valueRow(int i, int j) {
+        return values[i & (VALUE_SLOTS - 1)].data() + (j - jBegin) * rowLength;
+    }
+    inline unsigned char& valueRowReady(int i, int j) {
+        return valueReady[i & (VALUE_SLOTS - 1)][j - jBegin];
+    }
+    // axis 为 0, 1, 2 分别表示法线的 x, y, z 分量
+    inline float* normalRow(int i, int axis, int j) {
+        return normals[i & (NORMAL_SLOTS - 1)][axis].data() + (j - jBegin) * rowLength;
+    }
+    inline unsigned char& normalRowReady(int i, int j) {
+        return normalReady[i & (NORMAL_SLOTS - 1)][j - jBegin];
+    }
+
+   private:
+    static const int VALUE_SLOTS = 4, NORMAL_SLOTS = 2;
+    int jBegin = 0, rowLength = 0;
+    std::vector<float> values[VALUE_SLOTS];
+    std::vector<float> normals[NORMAL_SLOTS][3];
+    std::vector<unsigned char> valueReady[VALUE_SLOTS], normalReady[NORMAL_SLOTS];
+    int valuePlane[VALUE_SLOTS], normalPlane[NORMAL_SLOTS];
+};
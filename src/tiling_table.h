@@ -0,0 +1,94 @@
+﻿#pragma once
+// 把 LookUpTable.h 里面几十个 tilingX_Y 数组在编译期拼接成一张连续的表
+
+#include "LookUpTable.h"
+
+// 一种 tiling 子类在 TilingTable::edges 中的位置，center 表示用到了 cube 中心的 12 号点
+struct Tiling {
+    short offset;
+    unsigned char triangles;
+    bool center;
+};
+
+// 每个大类有多少种 configuration（cases[][1] 的取值个数），以及每种 configuration 有多少个子类
+// 子类的编号见 AmbiguityQueue::selectSubcase，例如 case 7: 0 是 7.1，1-3 是 7.2，4-6 是 7.3，7 是 7.4.1，8 是 7.4.2
+static constexpr int caseConfigurations[15] = {0, 16, 24, 24, 8, 48, 48, 16, 6, 8, 6, 12, 24, 2, 12};
+static constexpr int caseSubcases[15] = {0, 1, 1, 2, 2, 1, 3, 9, 1, 1, 5, 1, 5, 50, 1};
+
+struct TilingTable {
+    static constexpr int EDGES = 12420, TILINGS = 728;
+    char edges[EDGES];
+    Tiling tilings[TILINGS];
+    // 第 c 大类第 0 种 configuration 的第 0 个子类在 tilings 中的下标
+    int caseBase[15];
+    int edgeCount, tilingCount;
+
+    template <int N>
+    constexpr void append(const char (&row)[N]) {
+        bool center = false;
+        for (int e = 0; e < N; e++) {
+            edges[edgeCount + e] = row[e];
+            center = center || row[e] == 12;
+        }
+        tilings[tilingCount++] = {(short)edgeCount, (unsigned char)(N / 3), center};
+        edgeCount += N;
+    }
+    // 按照子类编号的顺序追加第 caseIdx 大类第 c 种 configuration 的所有子类
+    constexpr void appendSubcases(int caseIdx, int c) {
+        switch (caseIdx) {
+            case 1: append(tiling1[c]); break;
+            case 2: append(tiling2[c]); break;
+            case 3: append(tiling3_1[c]), append(tiling3_2[c]); break;
+            case 4: append(tiling4_1[c]), append(tiling4_2[c]); break;
+            case 5: append(tiling5[c]); break;
+            case 6: append(tiling6_1_1[c]), append(tiling6_1_2[c]), append(tiling6_2[c]); break;
+            case 7:
+                append(tiling7_1[c]);
+                for (int s = 0; s < 3; s++) append(tiling7_2[c][s]);
+                for (int s = 0; s < 3; s++) append(tiling7_3[c][s]);
+                append(tiling7_4_1[c]), append(tiling7_4_2[c]);
+                break;
+            case 8: append(tiling8[c]); break;
+            case 9: append(tiling9[c]); break;
+            case 10: append(tiling10_1_1[c]), append(tiling10_1_2[c]), append(tiling10_2[c]), append(tiling10_2_[c]), append(tiling10_1_1_[c]); break;
+            case 11: append(tiling11[c]); break;
+            case 12: append(tiling12_1_1[c]), append(tiling12_1_2[c]), append(tiling12_2[c]), append(tiling12_2_[c]), append(tiling12_1_1_[c]); break;
+            case 13:
+                // 和 subconfig13 的取值对应：0 是 13.1，1-6 是 13.2，7-18 是 13.3，19-22 是 13.4，23-26 是 13.5.1，
+                // 27-30 是 13.5.2，31-42 是 13.3_，43-48 是 13.2_，49 是 13.1_
+                append(tiling13_1[c]);
+                for (int s = 0; s < 6; s++) append(tiling13_2[c][s]);
+                for (int s = 0; s < 12; s++) append(tiling13_3[c][s]);
+                for (int s = 0; s < 4; s++) append(tiling13_4[c][s]);
+                for (int s = 0; s < 4; s++) append(tiling13_5_1[c][s]);
+                for (int s = 0; s < 4; s++) append(tiling13_5_2[c][s]);
+                for (int s = 0; s < 12; s++) append(tiling13_3_[c][s]);
+                for (int s = 0; s < 6; s++) append(tiling13_2_[c][s]);
+                append(tiling13_1_[c]);
+                break;
+            case 14: append(tiling14[c]); break;
+        }
+    }
+};
+
+constexpr TilingTable buildTilingTable() {
+    TilingTable table{};
+    for (int caseIdx = 0; caseIdx < 15; caseIdx++) {
+        table.caseBase[caseIdx] = table.tilingCount;
+        for (int c = 0; c < caseConfigurations[caseIdx]; c++) {
+            table.appendSubcases(caseIdx, c);
+        }
+    }
+    return table;
+}
+
+static constexpr TilingTable tilingTable = buildTilingTable();
+static_assert(tilingTable.edgeCount == TilingTable::EDGES && tilingTable.tilingCount == TilingTable::TILINGS, "TilingTable size mismatch");
+
+/**
+ * \brief 查表得到第 configurationIndex 种情况第 subcase 个子类的 tiling
+ */
+inline const Tiling& getTiling(int configurationIndex, int subcase) {
+    int caseIdx = cases[configurationIndex][0], c = cases[configurationIndex][1];
+    return tilingTable.tilings[tilingTable.caseBase[caseIdx] + c * caseSubcases[caseIdx] + subcase];
+}
@@ -0,0 +1,28 @@
+﻿#pragma once
+
+#include <cmath>
+
+struct Vertex {
+    // 顶点坐标
+    float x, y, z;
+    // 法向量
+    float nx, ny, nz;
+    Vertex(float x, float y, float z, float nx, float ny, float nz) : x(x), y(y), z(z), nx(nx), ny(ny), nz(nz) {
+        normalizeNormal();
+    }
+    Vertex& operator+=(const Vertex& rhs) {
+        x += rhs.x, y += rhs.y, z += rhs.z;
+        nx += rhs.nx, ny += rhs.ny, nz += rhs.nz;
+        return *this;
+    }
+    Vertex& operator/=(const int n) {
+        x /= n, y /= n, z /= n;
+        nx /= n, ny /= n, nz /= n;
+        return *this;
+    }
+    void normalizeNormal() {
+        float len2 = nx * nx + ny * ny + nz * nz;
+        float len = sqrt(len2);
+        nx /= len, ny /= len, nz /= len;
+    }
+};
@@ -0,0 +1,48 @@
+﻿#include "volume_pyramid.h"
+
+#include <algorithm>
+
+VolumePyramid::VolumePyramid(const unsigned short* data, std::array<int, 3> dim, std::array<float, 3> spacing, int levels) {
+    original = data;
+    dims.push_back(dim);
+    spacings.push_back(spacing);
+    downsampled.resize(levels);
+    for (int l = 1; l <= levels; l++) {
+        std::array<int, 3> srcDim = dims.back(), dstDim;
+        std::array<float, 3> dstSpacing = spacings.back();
+        for (int a = 0; a < 3; a++) {
+            dstDim[a] = (srcDim[a] + 1) / 2;
+            dstSpacing[a] *= 2;
+        }
+        downsampled[l - 1].resize((size_t)dstDim[0] * dstDim[1] * dstDim[2]);
+        downsample(this->data(l - 1), srcDim, downsampled[l - 1].data(), dstDim);
+        dims.push_back(dstDim);
+        spacings.push_back(dstSpacing);
+    }
+}
+
+void VolumePyramid::downsample(const unsigned short* src, std::array<int, 3> srcDim, unsigned short* dst, std::array<int, 3> dstDim) {
+#pragma omp parallel for
+    for (int i = 0; i < dstDim[0]; i++) {
+        int i1 = std::min(2 * i + 1, srcDim[0] - 1);
+        for (int j = 0; j < dstDim[1]; j++) {
+            int j1 = std::min(2 * j + 1, srcDim[1] - 1);
+            unsigned short* out = dst + ((size_t)i * dstDim[1] + j) * dstDim[2];
+            for (int k = 0; k < dstDim[2]; k++) {
+                int k1 = std::min(2 * k + 1, srcDim[2] - 1);
+                // 边界上奇数个体素的时候 i1 == 2i，只平均存在的体素
+                unsigned int sum = 0, count = 0;
+                for (int p = 2 * i; p <= i1; p++) {
+                    for (int q = 2 * j; q <= j1; q++) {
+                        const unsigned short* row = src + ((size_t)p * srcDim[1] + q) * srcDim[2];
+                        for (int r = 2 * k; r <= k1; r++) {
+                            sum += row[r];
+                            count++;
+                        }
+                    }
+                }
+                out[k] = (sum + count / 2) / count;
+            }
+        }
+    }
+}
@@ -0,0 +1,42 @@
+﻿#pragma once
+
+#include <array>
+#include <vector>
+
+/**
+ * \brief 体数据的多分辨率金字塔
+ *
+ * 第 0 层就是原始数据（不复制），第 l 层每个方向的体素数是第 l - 1 层的一半（向上取整），体素间距是两倍。
+ * 第 l 层的体素 (i, j, k) 是第 l - 1 层 (2i, 2j, 2k) 开始的 2 * 2 * 2 个体素的平均值（边界上只平均存在的体素），
+ * 坐标仍然按 (2i, 2j, 2k) 算，所以第 l 层的等值面相对原始数据会偏移 (2^l - 1) / 2 个原始体素，用来预览足够了。
+ * 读取数据之后构建一次，之后每一层都可以直接交给 MarchingCubes。
+ */
+class VolumePyramid {
+   public:
+    /**
+     * \param levels 除原始数据外的层数，默认构建 1/2, 1/4, 1/8 三层
+     */
+    VolumePyramid(const unsigned short* data, std::array<int, 3> dim, std::array<float, 3> spacing, int levels = 3);
+    // 包括原始数据在内的层数
+    inline int levelCount() const {
+        return dims.size();
+    }
+    inline const unsigned short* data(int level) const {
+        return level == 0 ? original : downsampled[level - 1].data();
+    }
+    inline std::array<int, 3> dim(int level) const {
+        return dims[level];
+    }
+    inline std::array<float, 3> spacing(int level) const {
+        return spacings[level];
+    }
+
+   private:
+    const unsigned short* original;
+    // 第 l 层（l >= 1）的数据存放在 downsampled[l - 1] 中
+    std::vector<std::vector<unsigned short>> downsampled;
+    std::vector<std::array<int, 3>> dims;
+    std::vector<std::array<float, 3>> spacings;
+    // 把 src 按 2 * 2 * 2 的块求平均缩小一半写入 dst
+    static void downsample(const unsigned short* src, std::array<int, 3> srcDim, unsigned short* dst, std::array<int, 3> dstDim);
+};
@@ -0,0 +1,71 @@
+﻿#pragma once
+
+#include <cstddef>
+
+/**
+ * \brief 支持的体素类型：8 位 micro-CT、有符号 16 位 CT（Hounsfield）、无符号 16 位 CBCT、32 位浮点的仿真数据
+ *
+ * MarchingCubes 只记下数据指针和类型，不复制、不转换数据。按行处理的内核（正负性、转成 float、求 min/max）都是按类型实例化的模板，
+ * 每处理一行之前按 VoxelType 分派一次，分派的开销可以忽略。
+ */
+enum VoxelType {
+    VOXEL_UINT8,
+    VOXEL_INT16,
+    VOXEL_UINT16,
+    VOXEL_FLOAT
+};
+
+template <typename T>
+struct VoxelTraits;
+template <>
+struct VoxelTraits<unsigned char> {
+    static constexpr VoxelType type = VOXEL_UINT8;
+};
+template <>
+struct VoxelTraits<short> {
+    static constexpr VoxelType type = VOXEL_INT16;
+};
+template <>
+struct VoxelTraits<unsigned short> {
+    static constexpr VoxelType type = VOXEL_UINT16;
+};
+template <>
+struct VoxelTraits<float> {
+    static constexpr VoxelType type = VOXEL_FLOAT;
+};
+
+/**
+ * \brief 把 data 转成 type 对应类型的指针调用 f，f 一般是参数为 auto 的 lambda，会对每种类型各实例化一次
+ */
+template <typename F>
+inline void dispatchVoxelType(VoxelType type, const void* data, F&& f) {
+    switch (type) {
+        case VOXEL_UINT8:
+            f((const unsigned char*)data);
+            break;
+        case VOXEL_INT16:
+            f((const short*)data);
+            break;
+        case VOXEL_UINT16:
+            f((const unsigned short*)data);
+            break;
+        case VOXEL_FLOAT:
+            f((const float*)data);
+            break;
+    }
+}
+
+// 读取单个体素并转成 float，只用在零散的访问上，按行处理的话用 dispatchVoxelType
+inline float voxelValue(VoxelType type, const void* data, size_t index) {
+    switch (type) {
+        case VOXEL_UINT8:
+            return ((const unsigned char*)data)[index];
+        case VOXEL_INT16:
+            return ((const short*)data)[index];
+        case VOXEL_UINT16:
+            return ((const unsigned short*)data)[index];
+        case VOXEL_FLOAT:
+            return ((const float*)data)[index];
+    }
+    return 0;
+}
@@ -0,0 +1,81 @@
+﻿#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "marching_cubes.h"
+
+// 顶点和法线都是有限的，法线不是 0，三角形引用的顶点都存在
+static bool checkMesh(const MarchingCubes& mc, const char* name) {
+    const auto& vertices = mc.getVertices();
+    const auto& triangles = mc.getTriangles();
+    for (const auto& v : vertices) {
+        float values[6] = {v.x, v.y, v.z, v.nx, v.ny, v.nz};
+        for (float value : values) {
+            if (!std::isfinite(value)) {
+                printf("%s: non-finite vertex (%g, %g, %g) normal (%g, %g, %g)\n", name, v.x, v.y, v.z, v.nx, v.ny, v.nz);
+                return false;
+            }
+        }
+        if (std::abs(v.nx * v.nx + v.ny * v.ny + v.nz * v.nz - 1) > 1e-3f) {
+            printf("%s: normal (%g, %g, %g) is not a unit vector\n", name, v.nx, v.ny, v.nz);
+            return false;
+        }
+    }
+    for (const auto& triangle : triangles) {
+        for (int index : triangle) {
+            if (index < 0 || index >= (int)vertices.size()) {
+                printf("%s: triangle references vertex %d of %d\n", name, index, (int)vertices.size());
+                return false;
+            }
+        }
+    }
+    if (triangles.empty()) {
+        printf("%s: no triangles\n", name);
+        return false;
+    }
+    return true;
+}
+
+// 8 个角都为正、里面只有一个体素为负的叶子：三线性插值的误差不超过 tolerance，但是角上看不出等值面，
+// 不能合并成一个叶子，否则算出来的顶点是 NaN，周围的三角形连到这个顶点上；凹坑是一个封闭的小曲面，也不能被合并掉。
+// scale 把值和 tolerance 一起缩小，梯度远小于 1 的时候法线也不能是 NaN
+static bool testSubCellDip(float scale) {
+    int n = 25;
+    std::vector<float> volume((size_t)n * n * n, 5.f * scale);
+    volume[((size_t)12 * n + 12) * n + 12] = -3.f * scale;
+    MarchingCubes mc(volume.data(), {n, n, n}, {1.f, 1.f, 1.f});
+    mc.algorithm = ALGORITHM_ADAPTIVE;
+    mc.adaptiveTolerance = 10 * scale;
+    if (!mc.runAlgorithm(0)) return false;
+    return checkMesh(mc, scale == 1 ? "testSubCellDip" : "testSubCellDip(small)");
+}
+
+// 值在 [0, 1] 之间的 float 球：step 为 true 时里面是 1、外面是 0，否则是 sigmoid，离球面远的地方梯度几乎为 0。
+// 叶子的角上的差分法线都远小于 1，有的分量正好是 0
+static bool testSmallGradientSphere(bool step, float tolerance, const char* name) {
+    int n = 40;
+    float center = (n - 1) / 2.f, radius = 12;
+    std::vector<float> volume((size_t)n * n * n);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            for (int k = 0; k < n; k++) {
+                float r = std::sqrt((i - center) * (i - center) + (j - center) * (j - center) + (k - center) * (k - center));
+                volume[((size_t)i * n + j) * n + k] = step ? (r < radius ? 1.f : 0.f) : 1 / (1 + std::exp(r - radius));
+            }
+        }
+    }
+    MarchingCubes mc(volume.data(), {n, n, n}, {1.f, 1.f, 1.f}, true);
+    mc.algorithm = ALGORITHM_ADAPTIVE;
+    mc.adaptiveTolerance = tolerance;
+    if (!mc.runAlgorithm(0.5f)) return false;
+    return checkMesh(mc, name);
+}
+
+int main() {
+    bool passed = testSubCellDip(1);
+    passed &= testSubCellDip(0.01f);
+    passed &= testSmallGradientSphere(true, 10, "testSmallGradientSphere(step)");
+    passed &= testSmallGradientSphere(false, 0.01f, "testSmallGradientSphere(sigmoid)");
+    printf("%s\n", passed ? "PASSED" : "FAILED");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,57 @@
+﻿#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "marching_cubes.h"
+
+// 值在 [0, 1] 之间的 float 球：每个体素的梯度只有 0.05 左右，法线的每个分量都远小于 1
+static bool testSmallGradientSphere(MarchingAlgorithm algorithm, const char* name) {
+    int n = 40;
+    float center = (n - 1) / 2.f, radius = 12;
+    std::vector<float> volume((size_t)n * n * n);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            for (int k = 0; k < n; k++) {
+                float r = std::sqrt((i - center) * (i - center) + (j - center) * (j - center) + (k - center) * (k - center));
+                volume[((size_t)i * n + j) * n + k] = std::min(std::max(0.5f + (radius - r) / 20, 0.f), 1.f);
+            }
+        }
+    }
+    // 球里面的值大，梯度朝里，反过来才是朝外的法线
+    MarchingCubes mc(volume.data(), {n, n, n}, {1.f, 1.f, 1.f}, true);
+    mc.algorithm = algorithm;
+    if (!mc.runAlgorithm(0.5f)) return false;
+    const auto& vertices = mc.getVertices();
+    if (vertices.empty()) {
+        printf("testSmallGradientSphere(%s): no vertices\n", name);
+        return false;
+    }
+    for (const auto& v : vertices) {
+        float values[6] = {v.x, v.y, v.z, v.nx, v.ny, v.nz};
+        for (float value : values) {
+            if (!std::isfinite(value)) {
+                printf("testSmallGradientSphere(%s): non-finite vertex (%g, %g, %g) normal (%g, %g, %g)\n", name, v.x, v.y, v.z, v.nx, v.ny, v.nz);
+                return false;
+            }
+        }
+        // 和从球心指向顶点的方向夹角不超过 25 度
+        float dx = v.x - center, dy = v.y - center, dz = v.z - center;
+        float cosine = (dx * v.nx + dy * v.ny + dz * v.nz) / std::sqrt(dx * dx + dy * dy + dz * dz);
+        if (!(cosine > std::cos(25 * 3.14159265f / 180))) {
+            printf("testSmallGradientSphere(%s): normal (%g, %g, %g) at (%g, %g, %g) does not point outward\n", name, v.nx, v.ny, v.nz, v.x, v.y, v.z);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    bool passed = testSmallGradientSphere(ALGORITHM_MC33, "mc33");
+    passed &= testSmallGradientSphere(ALGORITHM_CLASSIC, "classic");
+    passed &= testSmallGradientSphere(ALGORITHM_FLYING_EDGES, "flying edges");
+    passed &= testSmallGradientSphere(ALGORITHM_SURFACE_NETS, "surface nets");
+    passed &= testSmallGradientSphere(ALGORITHM_ADAPTIVE, "adaptive");
+    printf("%s\n", passed ? "PASSED" : "FAILED");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,44 @@
+﻿#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "marching_cubes.h"
+
+// 只有一个等值面的时候，结束之前也要报告进度，最后报告 1
+static bool testSingleSurfaceProgress(MarchingAlgorithm algorithm, const char* name) {
+    int n = 96;
+    float center = (n - 1) / 2.f;
+    std::vector<unsigned short> volume((size_t)n * n * n);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            for (int k = 0; k < n; k++) {
+                float r = std::sqrt((i - center) * (i - center) + (j - center) * (j - center) + (k - center) * (k - center));
+                volume[((size_t)i * n + j) * n + k] = (unsigned short)(1000 + 20 * (30 - r) + 10 * std::sin(i * 0.3f) * std::cos(k * 0.2f));
+            }
+        }
+    }
+    MarchingCubes mc(volume.data(), {n, n, n}, {1.f, 1.f, 1.f});
+    mc.algorithm = algorithm;
+    // 回调可能在不同的线程里面同时调用
+    std::atomic<int> intermediate{0}, finished{0};
+    bool completed = mc.runAlgorithm(1000, nullptr, [&](float progress) {
+        if (progress > 0 && progress < 1) intermediate++;
+        if (progress == 1) finished++;
+    });
+    if (!completed || intermediate == 0 || finished != 1) {
+        printf("testSingleSurfaceProgress(%s): %d intermediate reports, %d final reports\n", name, intermediate.load(), finished.load());
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    bool passed = testSingleSurfaceProgress(ALGORITHM_MC33, "mc33");
+    passed &= testSingleSurfaceProgress(ALGORITHM_CLASSIC, "classic");
+    passed &= testSingleSurfaceProgress(ALGORITHM_FLYING_EDGES, "flying edges");
+    passed &= testSingleSurfaceProgress(ALGORITHM_SURFACE_NETS, "surface nets");
+    passed &= testSingleSurfaceProgress(ALGORITHM_ADAPTIVE, "adaptive");
+    printf("%s\n", passed ? "PASSED" : "FAILED");
+    return passed ? 0 : 1;
+}